@@ -25,13 +25,22 @@
 #include "armv4vm_p.hpp"
 #include "properties.hpp"
 #include "memoryhandler.hpp"
+#include "predecode.hpp"
+#include "blockcache.hpp"
+#include "jit.hpp"
+#include "decoder.hpp"
 //#include "coprocessor.hpp"
 
 #include <array>
 #include <cstdint>
 #include <exception>
+#include <functional>
 #include <memory>
+#include <new>
 #include <string>
+#include <type_traits>
+#include <vector>
+#include <csetjmp>
 #include <cstring>
 #include <cassert>
 #include <fstream>
@@ -53,8 +62,12 @@ class alignas(32) AluBase {
   public:
 
     virtual std::byte  *reset() = 0;
+    virtual std::byte  *restore(const AluState &state = AluState()) = 0;
+    // Hors de run(), m_cpsr est toujours à jour.
+    AluState getState() const { return {m_registers, m_cpsr, m_spsr}; }
     //virtual uint64_t  load() = 0;
     virtual Interrupt run(const uint32_t nbMaxIteration = 0) = 0;
+    virtual RunResult run(const uint32_t nbMaxIteration, std::nothrow_t) = 0;
     std::array<uint32_t, 16> & getRegisters() noexcept { return m_registers; }
     uint32_t getCPSR() const;
     void     setCPSR(const uint32_t);
@@ -74,7 +87,8 @@ class alignas(32) AluBase {
 // concept CoproDerived = std::derived_from<T, CoprocessorInterface<T>>;
 
 
-template <typename MemoryHandler, typename CoproHandler> // Remettre les concepts MemDerived CoproDerived
+// Remettre les concepts MemDerived CoproDerived
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode = Dispatch::SWITCH>
 class Alu final : public AluBase {
 
   public:
@@ -83,6 +97,7 @@ class Alu final : public AluBase {
     friend class TestVfpInstruction<MemoryHandler>;
 
     Alu(struct AluProperties & properties) :
+        m_predecode(MicroOp{&Alu::predecodeOp, 0, 0, 0, 0, 0, 0, TARGET_PREDECODE}),
         m_sp(m_registers[13]),
         m_lr(m_registers[14]),
         m_pc(m_registers[15])
@@ -91,6 +106,11 @@ class Alu final : public AluBase {
 
         m_error = E_NONE;
         m_instructionSetFormat = unknown;
+        m_blockEnd = nullptr;
+        m_running = false;
+        m_interrupt = Interrupt::Undefined;
+        m_retired = 0;
+        m_faulted = false;
         m_registers.fill(0);
         m_spsr = 0;
         m_sp = m_registers[13];
@@ -102,12 +122,62 @@ class Alu final : public AluBase {
     ~Alu();
 
     std::byte *     reset() override;
+    // Retour à l'instantané de la mémoire (MemoryHandler::capture()) sans rien réallouer : seules les pages écrites
+    // depuis sont recopiées, les caches de code ne sont vidés que si l'une d'elles en contient.
+    std::byte *     restore(const AluState &state = AluState()) override;
+    // Comme reset(), sans toucher à la mémoire : reprise sur une mémoire déjà remplie (Vm::fork()).
+    std::byte *     resume(const AluState &state);
     //uint64_t        load() override;
     Interrupt       run(const uint32_t nbMaxIteration = 0) override;
+    // Sans exception : une faute mémoire arrête run() sur Interrupt::Fatal et est décrite dans le bilan.
+    RunResult       run(const uint32_t nbMaxIteration, std::nothrow_t) override;
 
     void attach(MemoryHandler *mem) { m_mem = mem; }
     void attach(CoproHandler *coprocessor) { m_coprocessor = coprocessor; }
 
+    // Gestionnaire de l'hôte pour le swi number, appelé dans run() avec le PC sur l'instruction suivante. nullptr
+    // rétablit la sortie de run().
+    using SwiHandler = std::function<SwiAction()>;
+
+    void setSwiHandler(const uint32_t number, SwiHandler handler) {
+
+        if (number >= m_swiHandlers.size()) {
+            m_swiHandlers.resize(number + 1);
+        }
+        m_swiHandlers[number] = std::move(handler);
+    }
+
+    // Accès de l'hôte depuis un gestionnaire de swi : permissions, fautes et invalidation du code de l'invité.
+    // Avec MemoryGuarded, la Guard est suspendue pendant le gestionnaire : les permissions sont vérifiées ici.
+    template <typename T>
+    T load(const uint32_t address) const {
+
+        if constexpr (MemoryHandler::HOST_FAULTS) {
+            m_mem->isAccessible(address, sizeof(T), AccessPermission::READ);
+        }
+        return m_mem->template readPointer<T>(address);
+    }
+
+    template <typename T>
+    void store(const uint32_t address, const T value) {
+
+        if constexpr (MemoryHandler::HOST_FAULTS) {
+            m_mem->isAccessible(address, sizeof(T), AccessPermission::WRITE);
+        }
+        writeMemory<T>(address, value);
+    }
+
+    // A appeler quand l'hôte modifie le code invité sans passer par l'ALU (chargement, etc.).
+    void flushCodeCaches() {
+        m_predecode.clear();
+        m_blocks.clear();
+#if ARMV4VM_JIT
+        if (m_code) {
+            m_code->reset();
+        }
+#endif
+    }
+
 public:
     enum Error {
 
@@ -128,14 +198,99 @@ public:
 
     enum Error           m_error;
 
+    // Instruction décodée une seule fois (mode PREDECODED).
+    // operand porte ce qui peut être calculé au décodage : operand2 d'un immédiat,
+    // offset d'un transfert ou cible d'un branchement.
+    // target désigne l'étiquette de runThreaded qui exécute l'entrée : les handlers
+    // précalculés y sont recopiés, les autres passent par handler.
+    // Les cibles directes ne servent qu'aux instructions AL ; les autres passent par TARGET_HANDLER.
+    enum ThreadedTarget : uint8_t {
+        TARGET_PREDECODE,
+        TARGET_HANDLER,
+        TARGET_DATA_PROCESSING_IMMEDIATE,
+        TARGET_DATA_PROCESSING_REGISTER,
+        TARGET_SINGLE_DATA_TRANSFER_IMMEDIATE,
+        TARGET_BRANCH,
+    };
+
+    struct MicroOp {
+        void (Alu::*handler)(const MicroOp &);
+        uint32_t instruction;
+        uint32_t operand;
+        uint8_t  rd;
+        uint8_t  rn;
+        uint8_t  rm;
+        uint8_t  flags;
+        uint8_t  target;
+
+        bool operator==(const MicroOp &) const = default;
+    };
+
+    Interrupt execute(const uint32_t nbMaxIteration);
+    Interrupt runInterpreter(const uint32_t nbMaxIteration);
+    Interrupt runPredecoded(const uint32_t nbMaxIteration);
+    Interrupt runThreaded(const uint32_t nbMaxIteration);
+    Interrupt runBlocks(const uint32_t nbMaxIteration);
+
+    using Block = typename BlockCache<MicroOp>::Block;
+
+    Block *translate(const uint32_t address);
+    inline void invalidateBlocks();
+
+    // Adresses que la mémoire replie sur son espace (MemoryMasked) : les caches de code sont indexés par l'adresse
+    // repliée, une écriture par un alias invalide donc le bon mot.
+    static constexpr uint32_t ADDRESS_MASK = [] {
+        if constexpr (requires { MemoryHandler::ADDRESS_MASK; }) {
+            return MemoryHandler::ADDRESS_MASK;
+        } else {
+            return 0xFFFFFFFFu;
+        }
+    }();
+
+    // Le JIT n'émet les accès mémoire que pour MemoryRaw.
+    static constexpr bool JIT_AVAILABLE = ARMV4VM_JIT && std::is_same_v<MemoryHandler, MemoryRaw>;
+
+#if ARMV4VM_JIT
+    void compile(Block *block);
+    static uint32_t jitExecute(Alu *alu, const MicroOp *op) noexcept;
+    static uint32_t jitInvalidate(Alu *alu, const uint32_t address, const uint32_t size) noexcept;
+#endif
+
+    static inline MicroOp predecode(const uint32_t address, const uint32_t instruction);
+    void           predecodeOp(const MicroOp &op);
+    std::shared_ptr<typename PredecodeCache<MicroOp>::Page> lendPage(const uint32_t index);
+    template <void (Alu::*Eval)()>
+    void evalOp(const MicroOp &op) {
+        m_workingInstruction = op.instruction;
+        (this->*Eval)();
+    }
+    void interpretOp(const MicroOp &op) {
+        decode(op.instruction);
+        evaluate();
+    }
+    // Conditional à false : instruction AL, la condition n'est pas évaluée.
+    template <bool Conditional>
+    void dataProcessingImmediateOp(const MicroOp &op);
+    template <bool Conditional>
+    void dataProcessingRegisterOp(const MicroOp &op);
+    template <bool Conditional>
+    void singleDataTransferImmediateOp(const MicroOp &op);
+    template <bool Conditional>
+    void branchOp(const MicroOp &op);
+
+    template <typename T>
+    inline void writeMemory(const uint32_t address, const T value);
+
     inline uint32_t fetch();
     inline void     decodev1(const uint32_t);
+    inline void     decodev2(const uint32_t);
     inline void     decode(const uint32_t i) {
-        decodev1(i);
+        decodev2(i);
     }
     inline void     evaluate();
 
     void dataProcessingEval();
+    inline void dataProcessingExecute(const uint32_t instruction, const uint32_t operand2, const uint32_t carry);
     void multiplyEval();
     void multiplyLongEval();
     void singleDataTranferEval();
@@ -164,205 +319,1088 @@ public:
     void setV() { m_cpsr |= 0x10000000; }
     void unsetV() { m_cpsr &= 0xEFFFFFFF; }
 
+    enum FlagsKind : uint8_t {
+        FLAGS_ADD, // C et V de operand1 + operand2
+        FLAGS_SUB, // C et V de operand1 - operand2
+    };
+
+    inline bool flagC() const;
+    inline void setLogicalFlags(const uint32_t result, const uint32_t carry);
+    inline void setArithmeticFlags(const FlagsKind kind, const uint32_t operand1, const uint32_t operand2,
+                                   const uint32_t result);
+
     struct Undefined {
 
         uint32_t : 28;
         uint32_t cond : 4;
     };
 
-    enum FormatSummary {
-
-        data_processing,
-        multiply,
-        multiply_long,
-        single_data_swap,
-        branch_and_exchange,
-        halfword_data_transfer_register_off,
-        halfword_data_transfer_immediate_off,
-        single_data_transfer,
-        undefined,
-        block_data_transfer,
-        branch,
-        coprocessor_data_transfer,
-        coprocessor_data_operation,
-        coprocessor_register_transfer,
-        software_interrupt,
-        unknown,
-    };
-
     FormatSummary m_instructionSetFormat;
 
+    PredecodeCache<MicroOp> m_predecode;
+    BlockCache<MicroOp>     m_blocks;
+
+    // Décodage des pages en lecture seule commun aux ALU de ce type parties de la même image (load(), fork).
+    std::shared_ptr<PredecodeShare<MicroOp>> m_sharedCode;
+
+    // Fin du bloc en cours d'exécution. nullptr arrête le bloc après l'instruction courante.
+    const MicroOp *m_blockEnd;
+
+#if ARMV4VM_JIT
+    std::unique_ptr<jit::CodeBuffer> m_code;
+#endif
+
     uint32_t & m_sp;
     uint32_t & m_lr;
     uint32_t & m_pc;
     uint32_t m_workingInstruction;
-    bool     m_running;
+
+    // Un swi arrête la boucle de run() en repassant m_running à false et en laissant son numéro dans m_interrupt.
+    bool      m_running;
+    Interrupt m_interrupt;
+
+    // Indexés par numéro de swi ; vide tant qu'aucun gestionnaire n'est posé.
+    std::vector<SwiHandler> m_swiHandlers;
+
+    // Valeur de retour des boucles : Undefined quand seul le budget d'instructions les a arrêtées.
+    Interrupt interrupted() const { return m_running ? Interrupt::Undefined : m_interrupt; }
+
+    // Bilan du dernier run(), écrit une seule fois en sortie de boucle.
+    uint64_t    m_retired;
+    bool        m_faulted;
+    MemoryFault m_fault;
+
+    inline void fault(const MemoryFault &memoryFault);
+
+    // Mémoire à fautes matérielles (MemoryHandler::HOST_FAULTS) : le siglongjmp abandonne les compteurs locaux des
+    // boucles, qui publient donc le leur avant chaque instruction. Sans effet pour les autres mémoires.
+    void checkpoint(const uint64_t retired) {
+        if constexpr (MemoryHandler::HOST_FAULTS) {
+            m_retired = retired;
+        }
+    }
 };
 
-class AluException : public std::exception {
-  public:
-    //using Interrupt = AluBase::Interrupt;
+//} // namespace armv4vm
+
+
+#if WIN32
+#pragma warning(pop)
+#endif
+
+static inline uint32_t getSigned24(const uint32_t i) { return ((i & 0x00800000) ? i | 0xFF000000 : i & 0x00FFFFFF); }
+static inline uint32_t getSigned16(const uint32_t i) { return ((i & 0x00008000) ? i | 0xFFFF0000 : i & 0x0000FFFF); }
+static inline uint32_t getSigned8(const uint32_t i) { return ((i & 0x00000080) ? i | 0xFFFFFF00 : i & 0x000000FF); }
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+std::byte* Alu<MemoryHandler, CoproHandler, DispatchMode>::reset() {
+
+    m_mem->reset();
+
+           //m_coprocessor = std::make_unique<CoprocessorBase<MemoryType>>(/*this->m_mem*/);
+           //m_coprocessor = createCoprocessor<MemoryType>(m_vmProperties.m_coproModel);
+
+    return resume(AluState());
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+std::byte* Alu<MemoryHandler, CoproHandler, DispatchMode>::resume(const AluState &state) {
+
+    m_predecode.reset(m_mem->size());
+    m_blocks.reset(m_mem->size());
+    m_sharedCode = nullptr;
+
+    if (const std::shared_ptr<const MemoryImage> &source = m_mem->pageImage().source()) {
+
+        m_sharedCode = PredecodeShare<MicroOp>::of(source, source->size());
+        m_predecode.lend([this](const uint32_t index) { return lendPage(index); });
+    }
+#if ARMV4VM_JIT
+    if (m_code) {
+        m_code->reset();
+    }
+#endif
+    m_registers = state.m_registers;
+    m_cpsr      = state.m_cpsr;
+    m_spsr      = state.m_spsr;
+
+    return m_mem->getAddressZero();
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+std::byte* Alu<MemoryHandler, CoproHandler, DispatchMode>::restore(const AluState &state) {
+
+    bool code = false;
+
+    m_mem->restore([this, &code](const uint32_t address) { code |= m_predecode.isCode(address); });
+
+    if (code) {
+        flushCodeCaches();
+    }
+
+    m_registers = state.m_registers;
+    m_cpsr      = state.m_cpsr;
+    m_spsr      = state.m_spsr;
+
+    return m_mem->getAddressZero();
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+Interrupt Alu<MemoryHandler, CoproHandler, DispatchMode>::run(const uint32_t nbMaxIteration) {
+
+    const RunResult result = run(nbMaxIteration, std::nothrow);
+
+    if (result.m_faulted) {
+        throw MemoryFaultException(result.m_fault);
+    }
+
+    return result.m_interrupt;
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+RunResult Alu<MemoryHandler, CoproHandler, DispatchMode>::run(const uint32_t nbMaxIteration, std::nothrow_t) {
+
+    Interrupt result = Interrupt::Undefined;
+
+    m_retired = 0;
+    m_faulted = false;
+
+    if constexpr (MemoryHandler::HOST_FAULTS) {
+
+        // Le gestionnaire de SIGSEGV revient ici, en abandonnant la boucle d'exécution.
+        typename MemoryHandler::Guard guard(*m_mem);
+
+        if (sigsetjmp(guard.context(), 0) == 0) {
+            result = execute(nbMaxIteration);
+        } else {
+            fault(guard.fault());
+            result = Interrupt::Fatal;
+        }
+    } else {
+        result = execute(nbMaxIteration);
+    }
+
+    return RunResult{result, m_retired, m_pc, m_faulted, m_fault};
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+Interrupt Alu<MemoryHandler, CoproHandler, DispatchMode>::execute(const uint32_t nbMaxIteration) {
+
+    Interrupt result = Interrupt::Undefined;
+
+    switch (m_properties.m_executionMode) {
+
+    case AluProperties::PREDECODED:
+        result = runPredecoded(nbMaxIteration);
+        break;
+
+    case AluProperties::BLOCK:
+    case AluProperties::JIT:
+        result = runBlocks(nbMaxIteration);
+        break;
+
+    case AluProperties::THREADED:
+        if constexpr (DispatchMode == Dispatch::THREADED) {
+            result = runThreaded(nbMaxIteration);
+        } else {
+            result = runPredecoded(nbMaxIteration);
+        }
+        break;
+
+    case AluProperties::INTERPRETER:
+    default:
+        result = runInterpreter(nbMaxIteration);
+        break;
+    }
+
+    return result;
+}
+
+// Faute d'accès mémoire pendant une instruction : la boucle s'arrête et le PC revient sur l'instruction fautive.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::fault(const MemoryFault &memoryFault) {
+
+    m_pc       -= 4;
+    m_faulted   = true;
+    m_fault     = memoryFault;
+    m_interrupt = Interrupt::Fatal;
+    m_running   = false;
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+Interrupt Alu<MemoryHandler, CoproHandler, DispatchMode>::runInterpreter(const uint32_t nbMaxIteration) {
+
+    uint32_t stage1  = 0;
+    uint64_t retired = 0;
+    m_running        = true;
+
+    try {
+
+        if (nbMaxIteration != 0) {
+
+            for (; m_running && retired < nbMaxIteration; retired++) {
+
+                checkpoint(retired);
+                stage1 = fetch();
+                decode(stage1);
+                evaluate();
+            }
+        } else {
+
+            for (; m_running; retired++) {
+
+                checkpoint(retired);
+                stage1 = fetch();
+                decode(stage1);
+                evaluate();
+            }
+        }
+    } catch (const MemoryFaultException &exception) {
+        fault(exception.fault());
+    }
+
+    m_retired = retired;
+    return interrupted();
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+Interrupt Alu<MemoryHandler, CoproHandler, DispatchMode>::runPredecoded(const uint32_t nbMaxIteration) {
+
+    MicroOp                                  *op      = nullptr;
+    typename PredecodeCache<MicroOp>::Cursor page;
+    uint64_t                                  retired = 0;
+    m_running                                         = true;
+
+    try {
+
+        for (; m_running && (nbMaxIteration == 0 || retired < nbMaxIteration); retired++) {
+
+            checkpoint(retired);
+            op = m_predecode.entry(m_pc, page);
+
+            if (op == nullptr) [[unlikely]] {
+
+                // Hors de l'espace couvert par le cache : le fetch classique signale l'erreur.
+                decode(fetch());
+                evaluate();
+                continue;
+            }
+
+            m_pc += 4;
+            (this->*op->handler)(*op);
+        }
+    } catch (const MemoryFaultException &exception) {
+        fault(exception.fault());
+    }
+
+    m_retired = retired;
+    return interrupted();
+}
+
+// Chaque étiquette se termine par son propre saut indirect vers l'instruction suivante :
+// le prédicteur de branchement dispose d'un historique par type d'instruction.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+Interrupt Alu<MemoryHandler, CoproHandler, DispatchMode>::runThreaded(const uint32_t nbMaxIteration) {
+
+#if defined(__GNUC__)
+    // Dans l'ordre de ThreadedTarget.
+    static const void *const TARGETS[] = {
+        &&predecodeTarget,
+        &&handlerTarget,
+        &&dataProcessingImmediateTarget,
+        &&dataProcessingRegisterTarget,
+        &&singleDataTransferImmediateTarget,
+        &&branchTarget,
+    };
+
+    MicroOp                                  *op       = nullptr;
+    typename PredecodeCache<MicroOp>::Cursor page;
+    uint64_t                                  executed = 0;
+    m_running                                          = true;
+
+#define THREADED_DISPATCH()                                                                                            \
+    if (nbMaxIteration != 0 && executed == nbMaxIteration) {                                                           \
+        goto done;                                                                                                     \
+    }                                                                                                                  \
+    checkpoint(executed);                                                                                              \
+    executed++;                                                                                                        \
+    op = m_predecode.entry(m_pc, page);                                                                                \
+    if (op == nullptr) [[unlikely]] {                                                                                  \
+        goto uncachedTarget;                                                                                           \
+    }                                                                                                                  \
+    m_pc += 4;                                                                                                         \
+    goto *TARGETS[op->target]
+
+    try {
+
+        THREADED_DISPATCH();
+
+    predecodeTarget:
+        *op = predecode(m_pc - 4, m_mem->template readPointer<uint32_t>(m_pc - 4));
+        goto *TARGETS[op->target];
+
+    handlerTarget:
+        // swi passe toujours par ici : les cibles directes n'ont pas à tester m_running.
+        (this->*op->handler)(*op);
+        if (!m_running) [[unlikely]] {
+            goto done;
+        }
+        THREADED_DISPATCH();
+
+    dataProcessingImmediateTarget:
+        dataProcessingImmediateOp<false>(*op);
+        THREADED_DISPATCH();
+
+    dataProcessingRegisterTarget:
+        dataProcessingRegisterOp<false>(*op);
+        THREADED_DISPATCH();
+
+    singleDataTransferImmediateTarget:
+        singleDataTransferImmediateOp<false>(*op);
+        THREADED_DISPATCH();
+
+    branchTarget:
+        branchOp<false>(*op);
+        THREADED_DISPATCH();
+
+    uncachedTarget:
+        // Hors de l'espace couvert par le cache : le fetch classique signale l'erreur.
+        decode(fetch());
+        evaluate();
+        if (!m_running) [[unlikely]] {
+            goto done;
+        }
+        THREADED_DISPATCH();
+    } catch (const MemoryFaultException &exception) {
+
+        // L'instruction fautive a déjà été comptée par THREADED_DISPATCH.
+        executed--;
+        fault(exception.fault());
+    }
+
+#undef THREADED_DISPATCH
+
+done:
+    m_retired = executed;
+    return interrupted();
+#else
+    return runPredecoded(nbMaxIteration);
+#endif
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+Interrupt Alu<MemoryHandler, CoproHandler, DispatchMode>::runBlocks(const uint32_t nbMaxIteration) {
+
+    Block    *block      = nullptr;
+    uint32_t  generation = m_blocks.generation();
+    uint32_t  remaining  = nbMaxIteration;
+    uint64_t  retired    = 0;
+    [[maybe_unused]] const bool jit = JIT_AVAILABLE && m_properties.m_executionMode == AluProperties::JIT;
+    m_running = true;
+
+    // Un swi termine toujours son bloc : m_running n'est testé qu'entre deux blocs.
+    while (m_running && (nbMaxIteration == 0 || remaining != 0)) {
+
+        if (generation != m_blocks.generation()) [[unlikely]] {
+
+            // Blocs retirés par une écriture : plus aucun ne s'exécute, ils peuvent être libérés.
+            m_blocks.collect();
+            generation = m_blocks.generation();
+            block      = nullptr;
+        }
+
+        Block *next = block != nullptr ? block->successor(m_pc) : nullptr;
+
+        if (next == nullptr) {
+
+            next = m_blocks.find(m_pc);
+
+            if (next == nullptr) {
+                next = translate(m_pc);
+            }
+
+            if (next == nullptr) [[unlikely]] {
+
+                // Hors de l'espace couvert par le cache : le fetch classique signale l'erreur.
+                try {
+                    checkpoint(retired);
+                    decode(fetch());
+                    evaluate();
+                    remaining--;
+                    retired++;
+                } catch (const MemoryFaultException &exception) {
+                    fault(exception.fault());
+                }
+                block = nullptr;
+                continue;
+            }
+
+            if (block != nullptr) {
+                block->link(m_pc, next);
+            }
+        }
+
+        block = next;
+
+        const MicroOp *op = block->ops;
+
+#if ARMV4VM_JIT
+        if constexpr (JIT_AVAILABLE) {
+
+            if (jit) {
+
+                if (block->native == nullptr && block->hits++ == m_properties.m_jitThreshold) {
+                    compile(block);
+                }
+
+                if (block->native != nullptr && (nbMaxIteration == 0 || remaining >= block->nativeCount)) {
+
+                    const uint32_t executed = block->native(this, m_registers.data());
+                    remaining -= executed;
+                    retired   += executed;
+
+                    // Bloc terminé, ou sortie anticipée après une écriture dans du code traduit.
+                    if (executed == block->count || generation != m_blocks.generation()) {
+                        continue;
+                    }
+
+                    op += executed;
+                }
+            }
+        }
+#endif
+
+        // Le budget n'est vérifié qu'ici : un bloc plus long que le reste n'en exécute que le début.
+        const uint32_t left  = block->count - static_cast<uint32_t>(op - block->ops);
+        const uint32_t count = nbMaxIteration != 0 && remaining < left ? remaining : left;
+        const MicroOp *first = op;
+        m_blockEnd           = op + count;
+
+        try {
+
+            while (op < m_blockEnd) {
+
+                checkpoint(retired + static_cast<uint64_t>(op - first));
+                m_pc += 4;
+                (this->*op->handler)(*op);
+                op++;
+            }
+        } catch (const MemoryFaultException &exception) {
+            fault(exception.fault());
+        }
+
+        remaining -= static_cast<uint32_t>(op - first);
+        retired   += static_cast<uint64_t>(op - first);
+    }
+
+    m_retired = retired;
+    return interrupted();
+}
+
+// Décode les instructions depuis address jusqu'à une fin de bloc ou la fin de la page du cache.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+typename Alu<MemoryHandler, CoproHandler, DispatchMode>::Block *
+Alu<MemoryHandler, CoproHandler, DispatchMode>::translate(const uint32_t address) {
+
+    static constexpr uint32_t PAGE_SIZE = 1u << PredecodeCache<MicroOp>::PAGE_BITS;
+
+    MicroOp *ops = m_predecode.entry(address);
+
+    if (ops == nullptr || (address & 3u)) {
+        return nullptr;
+    }
+
+    const uint32_t count = (PAGE_SIZE - (address & (PAGE_SIZE - 1))) >> 2;
+    uint32_t       size  = 0;
+
+    while (size < count) {
+
+        MicroOp &op = ops[size];
+
+        if (op.handler == &Alu::predecodeOp) {
+
+            // Un mot illisible termine le bloc : la faute n'est levée que si l'exécution l'atteint.
+            if (!m_mem->readable(address + size * 4)) {
+                break;
+            }
+
+            op = predecode(address + size * 4, m_mem->template readPointer<uint32_t>(address + size * 4));
+        }
+
+        size++;
+
+        if (decoder::endsBasicBlock(op.instruction)) {
+            break;
+        }
+    }
+
+    if (size == 0) {
+        return nullptr;
+    }
+
+    return m_blocks.insert(address, ops, size);
+}
+
+#if ARMV4VM_JIT
+
+// Instruction non traduite en x86 : exécutée par son handler depuis le code natif.
+// Vrai si elle a retiré les blocs (écriture dans du code traduit).
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+uint32_t Alu<MemoryHandler, CoproHandler, DispatchMode>::jitExecute(Alu *alu, const MicroOp *op) noexcept {
+
+    const uint32_t generation = alu->m_blocks.generation();
+
+    (alu->*op->handler)(*op);
+
+    return generation != alu->m_blocks.generation();
+}
+
+// Écriture native dans une page de code : mêmes invalidations que writeMemory.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+uint32_t Alu<MemoryHandler, CoproHandler, DispatchMode>::jitInvalidate(Alu *alu, const uint32_t address,
+                                                                       const uint32_t size) noexcept {
+
+    const uint32_t generation = alu->m_blocks.generation();
+
+    if (alu->m_predecode.invalidate(address, size)) {
+        alu->invalidateBlocks();
+    }
+
+    return generation != alu->m_blocks.generation();
+}
+
+// Traduit en x86-64 le plus long préfixe du bloc sans swi, coprocesseur ni instruction indéfinie.
+// Traitements de données, ldr/str à offset immédiat et branchements sont émis en natif, le reste
+// passe par jitExecute. Les registres invités les plus utilisés vivent dans des registres hôtes
+// le temps du bloc ; r14 hôte porte l'ALU, r15 hôte le tableau des registres invités.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::compile(Block *block) {
+
+    using namespace jit;
+
+    enum Kind { DATA_PROCESSING, TRANSFER, BRANCH, CALL, STOP };
+    enum Opcode { AND, EOR, SUB, RSB, ADD, ADC, SBC, RSC, TST, TEQ, CMP, CMN, ORR, MOV, BIC, MVN };
+    enum { LOAD = 0x1, BYTE = 0x2, WRITE_BACK = 0x4, POST_INDEXED = 0x8 };
+
+    static constexpr Reg      CACHE[]  = {RBX, RBP, R12, R13, RSI, RDI, R8, R9, R10, R11};
+    static constexpr uint32_t NZ_MASK  = 0xC0000000;
+    static constexpr uint8_t  UNCACHED = 0xFF;
+
+    const auto kindOf = [](const MicroOp &op) {
+
+        const uint32_t instruction = op.instruction;
+        const uint32_t opcode      = BITS(instruction, 21, 24);
+        const bool     s           = instruction & 0x00100000;
+        const bool     logical     = opcode <= EOR || opcode == TST || opcode == TEQ || opcode >= ORR;
+
+        if (op.handler == &Alu::predecodeOp || op.handler == &Alu::interpretOp) {
+            return STOP;
+        }
+
+        switch (decoder::decode(instruction)) {
+
+        case software_interrupt:
+        case coprocessor_data_transfer:
+        case coprocessor_data_operation:
+        case coprocessor_register_transfer:
+        case undefined:
+        case unknown:
+            return STOP;
+
+        case data_processing:
+            if ((instruction >> 28) == 0xF || op.rd == 15 || opcode == ADC || opcode == SBC || opcode == RSC ||
+                (opcode >= TST && opcode <= CMN && !s)) {
+                return CALL;
+            }
+            if (instruction & 0x02000000) {
+                return DATA_PROCESSING;
+            }
+            if (instruction & 0x10) {
+                return CALL; // décalage par registre
+            }
+            if (BITS(instruction, 4, 11) == 0) {
+                return DATA_PROCESSING;
+            }
+            // Décalage immédiat : ROR #0 (RRX) et la retenue d'un décalage logique restent interprétés.
+            if ((BITS(instruction, 5, 6) == 3 && BITS(instruction, 7, 11) == 0) || (s && logical)) {
+                return CALL;
+            }
+            return DATA_PROCESSING;
+
+        case single_data_transfer:
+            if ((instruction >> 28) == 0xF || (op.handler != &Alu::singleDataTransferImmediateOp<false> &&
+                                                  op.handler != &Alu::singleDataTransferImmediateOp<true>) ||
+                ((op.flags & LOAD) && op.rd == 15) || ((op.flags & (WRITE_BACK | POST_INDEXED)) && op.rn == 15)) {
+                return CALL;
+            }
+            return TRANSFER;
+
+        case branch:
+            return (instruction >> 28) == 0xF ? CALL : BRANCH;
+
+        default:
+            return CALL;
+        }
+    };
+
+    // Préfixe traduisible et registres invités à garder dans des registres hôtes.
+    uint32_t                 count = 0;
+    std::array<uint32_t, 16> uses  = {};
+
+    for (; count < block->count; count++) {
+
+        const MicroOp &op   = block->ops[count];
+        const Kind     kind = kindOf(op);
+
+        if (kind == STOP) {
+            break;
+        }
+
+        if (kind == DATA_PROCESSING || kind == TRANSFER) {
+
+            uses[op.rd]++;
+            uses[op.rn]++;
+            uses[op.rm] += (op.instruction & 0x02000000) == 0;
+        }
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    std::array<uint8_t, 16> hosts = {};
+    hosts.fill(UNCACHED);
+
+    for (const Reg reg : CACHE) {
+
+        uint32_t best = 15;
+
+        for (uint32_t guest = 0; guest < 15; guest++) {
+
+            if (hosts[guest] == UNCACHED && uses[guest] > (best == 15 ? 0 : uses[best])) {
+                best = guest;
+            }
+        }
+
+        if (best == 15) {
+            break;
+        }
+
+        hosts[best] = reg;
+    }
+
+    const int32_t cpsr = static_cast<int32_t>(reinterpret_cast<const std::byte *>(&m_cpsr) -
+                                              reinterpret_cast<const std::byte *>(m_registers.data()));
+    const uint64_t memory = reinterpret_cast<uint64_t>(m_mem->getAddressZero());
+    const uint64_t pages  = reinterpret_cast<uint64_t>(m_predecode.presentPages());
+    const uint64_t dirty  = reinterpret_cast<uint64_t>(m_mem->pageImage().dirtyPages());
+
+    static_assert(PageImage::PAGE_BITS == PredecodeCache<MicroOp>::PAGE_BITS);
+
+    Emitter                  e;
+    std::vector<std::size_t> spillExits;
+    std::vector<std::size_t> plainExits;
+
+    const auto read = [&](const Reg dst, const uint32_t guest, const uint32_t pcValue) {
+
+        if (guest == 15) {
+            e.mov(dst, pcValue);
+        } else if (hosts[guest] != UNCACHED) {
+            e.mov(dst, static_cast<Reg>(hosts[guest]));
+        } else {
+            e.load(dst, R15, static_cast<int32_t>(guest * 4));
+        }
+    };
+
+    const auto write = [&](const uint32_t guest, const Reg src) {
+
+        if (hosts[guest] != UNCACHED) {
+            e.mov(static_cast<Reg>(hosts[guest]), src);
+        } else {
+            e.store(R15, static_cast<int32_t>(guest * 4), src);
+        }
+    };
+
+    const auto spill = [&]() {
+
+        for (uint32_t guest = 0; guest < 15; guest++) {
+            if (hosts[guest] != UNCACHED) {
+                e.store(R15, static_cast<int32_t>(guest * 4), static_cast<Reg>(hosts[guest]));
+            }
+        }
+    };
+
+    const auto reload = [&]() {
+
+        for (uint32_t guest = 0; guest < 15; guest++) {
+            if (hosts[guest] != UNCACHED) {
+                e.load(static_cast<Reg>(hosts[guest]), R15, static_cast<int32_t>(guest * 4));
+            }
+        }
+    };
+
+    // Sortie du bloc : PC invité, nombre d'instructions exécutées, puis épilogue.
+    const auto exit = [&](const uint32_t pc, const uint32_t executed, const bool cached) {
+
+        e.store(R15, 60, pc);
+        e.mov(RAX, executed);
+        (cached ? spillExits : plainExits).push_back(e.jump());
+    };
+
+    // Saute par-dessus l'instruction quand sa condition ne passe pas. 0 : toujours exécutée.
+    const auto condition = [&](const uint32_t instruction) -> std::size_t {
+
+        if ((instruction >> 28) == 0xE) {
+            return 0;
+        }
+
+        e.load(RAX, R15, cpsr);
+        e.shift(SHR, RAX, 28);
+        e.mov(RCX, decoder::CONDITION_TABLE[instruction >> 28]);
+        e.bitTest(RCX, RAX);
+        return e.jump(NOT_CARRY);
+    };
+
+    // N et Z du résultat (eax) ajoutés à edx, puis fusion dans le CPSR des bits de mask.
+    const auto updateFlags = [&](const uint32_t mask) {
+
+        e.test(RAX, RAX);
+        e.set(SIGN, RCX);
+        e.shift(SHL, RCX, 31);
+        e.alu(AluOp::OR, RDX, RCX);
+        e.test(RAX, RAX);
+        e.set(ZERO, RCX);
+        e.shift(SHL, RCX, 30);
+        e.alu(AluOp::OR, RDX, RCX);
+        e.load(RCX, R15, cpsr);
+        e.alu(AluOp::AND, RCX, ~mask);
+        e.alu(AluOp::OR, RCX, RDX);
+        e.store(R15, cpsr, RCX);
+    };
+
+    e.push(RBX);
+    e.push(RBP);
+    e.push(R12);
+    e.push(R13);
+    e.push(R14);
+    e.push(R15);
+    e.adjustStack(-8);
+    e.mov64(R14, RDI);
+    e.mov64(R15, RSI);
+    reload();
+
+    for (uint32_t i = 0; i < count; i++) {
+
+        const MicroOp &op          = block->ops[i];
+        const uint32_t instruction = op.instruction;
+        const uint32_t address     = block->start + i * 4;
+
+        switch (kindOf(op)) {
+
+        case DATA_PROCESSING: {
+
+            const std::size_t skip   = condition(instruction);
+            const uint32_t    opcode = BITS(instruction, 21, 24);
+            const bool        s      = instruction & 0x00100000;
+
+            // operand2 dans ecx
+            if (instruction & 0x02000000) {
+                e.mov(RCX, op.operand);
+            } else {
+
+                static constexpr ShiftOp SHIFTS[] = {SHL, SHR, SAR, ROR};
+                const uint8_t            amount   = static_cast<uint8_t>(BITS(instruction, 7, 11));
+
+                read(RCX, op.rm, address + 8);
+                if (amount != 0) {
+                    e.shift(SHIFTS[BITS(instruction, 5, 6)], RCX, amount);
+                }
+            }
+
+            // résultat dans eax
+            switch (opcode) {
+
+            case MOV:
+                e.mov(RAX, RCX);
+                break;
 
-    AluException(Interrupt interrupt = Interrupt::Resume)
-        : m_interrupt(interrupt) {}
-    Interrupt m_interrupt;
-};
+            case MVN:
+                e.mov(RAX, RCX);
+                e.bitwiseNot(RAX);
+                break;
 
-//} // namespace armv4vm
+            case RSB:
+                e.mov(RAX, RCX);
+                read(RCX, op.rn, address + 8);
+                e.alu(AluOp::SUB, RAX, RCX);
+                break;
 
+            case BIC:
+                // Comme l'interpréteur, BIC lit rn sans l'avance de PC.
+                e.bitwiseNot(RCX);
+                read(RAX, op.rn, address + 4);
+                e.alu(AluOp::AND, RAX, RCX);
+                break;
 
-#if WIN32
-#pragma warning(pop)
-#endif
+            default: {
 
-static inline uint32_t getSigned24(const uint32_t i) { return ((i & 0x00800000) ? i | 0xFF000000 : i & 0x00FFFFFF); }
-static inline uint32_t getSigned16(const uint32_t i) { return ((i & 0x00008000) ? i | 0xFFFF0000 : i & 0x0000FFFF); }
-static inline uint32_t getSigned8(const uint32_t i) { return ((i & 0x00000080) ? i | 0xFFFFFF00 : i & 0x000000FF); }
+                static constexpr AluOp OPERATIONS[] = {
+                    AluOp::AND, AluOp::XOR, AluOp::SUB, AluOp::SUB, AluOp::ADD, AluOp::ADD, AluOp::SUB, AluOp::SUB,
+                    AluOp::AND, AluOp::XOR, AluOp::SUB, AluOp::ADD, AluOp::OR,  AluOp::OR,  AluOp::AND, AluOp::AND};
 
-template <typename MemoryHandler, typename CoproHandler>
-std::byte* Alu<MemoryHandler, CoproHandler>::reset() {
+                read(RAX, op.rn, address + 8);
+                e.alu(OPERATIONS[opcode], RAX, RCX);
+                break;
+            }
+            }
 
-    m_mem->reset();
-    m_registers.fill(0);
-    m_cpsr = 0;
-    m_spsr = 0;
+            if (s) {
+
+                switch (opcode) {
+
+                case SUB:
+                case RSB:
+                case ADD:
+                case CMP:
+                case CMN:
+                    e.set(OVERFLOW, RDX);
+                    e.set(opcode == ADD || opcode == CMN ? CARRY : NOT_CARRY, RCX);
+                    e.shift(SHL, RDX, 28);
+                    e.shift(SHL, RCX, 29);
+                    e.alu(AluOp::OR, RDX, RCX);
+                    updateFlags(0xF0000000);
+                    break;
+
+                default:
+                    // Opérations logiques : C vient du décalage de l'immédiat, sinon le CPSR est conservé.
+                    if ((instruction & 0x02000000) && !(op.flags & 0x2)) {
+
+                        e.mov(RDX, static_cast<uint32_t>(op.flags & 0x1) << 29);
+                        updateFlags(NZ_MASK | 0x20000000);
+                    } else {
+
+                        e.mov(RDX, 0u);
+                        updateFlags(NZ_MASK);
+                    }
+                    break;
+                }
+            }
 
-           //m_coprocessor = std::make_unique<CoprocessorBase<MemoryType>>(/*this->m_mem*/);
-           //m_coprocessor = createCoprocessor<MemoryType>(m_vmProperties.m_coproModel);
+            if (opcode < TST || opcode > CMN) {
+                write(op.rd, RAX);
+            }
 
-    return m_mem->getAddressZero();
-}
+            if (skip != 0) {
+                e.bind(skip);
+            }
+            break;
+        }
 
-template <typename MemoryHandler, typename CoproHandler>
-Interrupt Alu<MemoryHandler, CoproHandler>::run(const uint32_t nbMaxIteration) {
+        case TRANSFER: {
 
-    Interrupt result        = Interrupt::Undefined;
-    static uint32_t              stage1        = 0;
-    m_running = true;
+            const std::size_t skip      = condition(instruction);
+            const bool        byte      = op.flags & BYTE;
+            const bool        writeBack = op.flags & (WRITE_BACK | POST_INDEXED);
 
-    try {
+            // adresse dans ecx
+            read(RCX, op.rn, address + 8);
+            if (!(op.flags & POST_INDEXED) && op.operand != 0) {
+                e.alu(AluOp::ADD, RCX, op.operand);
+            }
 
-        if (nbMaxIteration != 0) {
+            if (op.flags & LOAD) {
 
-            for (uint32_t i = 0; i < nbMaxIteration; i++) {
+                e.mov64(RDX, memory);
+                e.loadIndexed(RAX, RDX, RCX, byte);
+                write(op.rd, RAX);
+            } else {
 
-                stage1 = fetch();
-                decode(stage1);
-                evaluate();
+                read(RAX, op.rd, address + 12);
+                e.mov64(RDX, memory);
+                e.storeIndexed(RDX, RCX, RAX, byte);
             }
-        } else {
 
-            while (true) {
+            if (writeBack) {
 
-                stage1 = fetch();
-                decode(stage1);
-                evaluate();
+                e.mov(RAX, RCX);
+                if ((op.flags & POST_INDEXED) && op.operand != 0) {
+                    e.alu(AluOp::ADD, RAX, op.operand);
+                }
+                write(op.rn, RAX);
+            }
+
+            if (!(op.flags & LOAD)) {
+
+                // Pages du premier et du dernier octet écrits : marquées pour Alu::restore(), puis invalidation hors
+                // du code natif si elles contiennent du code.
+                std::vector<std::size_t> code;
+
+                for (const uint32_t offset : {0u, byte ? 0u : 3u}) {
+
+                    e.mov(RAX, RCX);
+                    if (offset != 0) {
+                        e.alu(AluOp::ADD, RAX, offset);
+                    }
+                    e.shift(SHR, RAX, PredecodeCache<MicroOp>::PAGE_BITS);
+                    e.alu(AluOp::CMP, RAX, static_cast<uint32_t>(m_mem->pageImage().pageCount()));
+                    const std::size_t untracked = e.jump(NOT_CARRY);
+                    e.mov64(RDX, dirty);
+                    e.storeIndexed(RDX, RAX, 1);
+                    e.bind(untracked);
+                    e.alu(AluOp::CMP, RAX, static_cast<uint32_t>(m_predecode.pageCount()));
+                    const std::size_t outside = e.jump(NOT_CARRY);
+                    e.mov64(RDX, pages);
+                    e.cmpIndexed(RDX, RAX, 0);
+                    code.push_back(e.jump(NOT_ZERO));
+                    e.bind(outside);
+                }
+                const std::size_t data = e.jump();
+
+                for (const std::size_t label : code) {
+                    e.bind(label);
+                }
+                spill();
+                e.mov64(RDI, R14);
+                e.mov(RSI, RCX);
+                e.mov(RDX, byte ? 1u : 4u);
+                e.mov64(RAX, reinterpret_cast<uint64_t>(&Alu::jitInvalidate));
+                e.call(RAX);
+                e.test(RAX, RAX);
+                const std::size_t kept = e.jump(ZERO);
+                exit(address + 4, i + 1, false);
+                e.bind(kept);
+                reload();
+                e.bind(data);
+            }
+
+            if (skip != 0) {
+                e.bind(skip);
             }
+            break;
         }
-    } catch (AluException &exception) {
 
-        result = exception.m_interrupt;
-    }
+        case BRANCH: {
 
-    return result;
-}
+            const std::size_t skip = condition(instruction);
 
-template <typename MemoryHandler, typename CoproHandler>
-uint32_t Alu<MemoryHandler, CoproHandler>::fetch() {
+            if (op.flags) {
 
-    uint32_t result = m_mem->template readPointer<uint32_t>(m_pc);
-    m_pc += 4;
+                e.mov(RAX, address + 4);
+                write(14, RAX);
+            }
+            exit(op.operand, i + 1, true);
 
-    return result;
-}
+            if (skip != 0) {
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::decodev1(const uint32_t instruction) {
+                e.bind(skip);
+                exit(address + 4, i + 1, true);
+            }
+            break;
+        }
 
-    static const uint32_t DATA_PROCESSING                      = 0x00000000;
-    static const uint32_t MULTIPLY                             = 0x00000090;
-    static const uint32_t MULTIPLY_LONG                        = 0x00800090;
-    static const uint32_t SINGLE_DATA_SWAP                     = 0x01000090;
-    static const uint32_t BRANCH_AND_EXCHANGE                  = 0x012FFF10;
-    static const uint32_t HALFWORD_DATA_TRANSFER_REGISTER_OFF  = 0x00000090;
-    static const uint32_t HALFWORD_DATA_TRANSFER_IMMEDIATE_OFF = 0x00400090;
-    static const uint32_t SINGLE_DATA_TRANSFER                 = 0x04000000;
-    static const uint32_t UNDEFINED                            = 0x06000010;
-    static const uint32_t BLOCK_DATA_TRANSFER                  = 0x08000000;
-    static const uint32_t BRANCH                               = 0x0A000000;
-    static const uint32_t COPROCESSOR_DATA_TRANSFER            = 0x0C000000;
-    static const uint32_t COPROCESSOR_DATA_OPERATION           = 0x0E000000;
-    static const uint32_t COPROCESSOR_REGISTER_TRANSFER        = 0x0E000010;
-    static const uint32_t SOFTWARE_INTERRUPT                   = 0x0F000000;
+        case CALL:
+        default: {
 
-    static const uint32_t MASK_DATA_PROCESSING                      = 0x0C000000;
-    static const uint32_t MASK_MULTIPLY                             = 0x0FC000F0;
-    static const uint32_t MASK_MULTIPLY_LONG                        = 0x0F8000F0;
-    static const uint32_t MASK_SINGLE_DATA_SWAP                     = 0x0FB00FF0;
-    static const uint32_t MASK_BRANCH_AND_EXCHANGE                  = 0x0FFFFFF0;
-    static const uint32_t MASK_HALFWORD_DATA_TRANSFER_REGISTER_OFF  = 0x0E400F90;
-    static const uint32_t MASK_HALFWORD_DATA_TRANSFER_IMMEDIATE_OFF = 0x0E400090;
-    static const uint32_t MASK_SINGLE_DATA_TRANSFER                 = 0x0C000000;
-    static const uint32_t MASK_UNDEFINED                            = 0x0E000010;
-    static const uint32_t MASK_BLOCK_DATA_TRANSFER                  = 0x0E000000;
-    static const uint32_t MASK_BRANCH                               = 0x0E000000;
-    static const uint32_t MASK_COPROCESSOR_DATA_TRANSFER            = 0x0E000000;
-    static const uint32_t MASK_COPROCESSOR_DATA_OPERATION           = 0x0F000010;
-    static const uint32_t MASK_COPROCESSOR_REGISTER_TRANSFER        = 0x0F000010;
-    static const uint32_t MASK_SOFTWARE_INTERRUPT                   = 0x0F000000;
+            spill();
+            e.store(R15, 60, address + 4);
+            e.mov64(RDI, R14);
+            e.mov64(RSI, reinterpret_cast<uint64_t>(&op));
+            e.mov64(RAX, reinterpret_cast<uint64_t>(&Alu::jitExecute));
+            e.call(RAX);
 
-    m_workingInstruction = instruction;
+            // Dernière instruction du bloc : PC est déjà celui laissé par le handler.
+            if (i + 1 == block->count && decoder::endsBasicBlock(instruction)) {
 
-    if ((instruction & MASK_BRANCH_AND_EXCHANGE) == BRANCH_AND_EXCHANGE) {
+                e.mov(RAX, i + 1);
+                plainExits.push_back(e.jump());
+            } else {
 
-        m_instructionSetFormat = branch_and_exchange;
-    } else if ((instruction & MASK_SINGLE_DATA_SWAP) == SINGLE_DATA_SWAP) {
+                e.test(RAX, RAX);
+                const std::size_t kept = e.jump(ZERO);
+                e.mov(RAX, i + 1);
+                plainExits.push_back(e.jump());
+                e.bind(kept);
+                reload();
+            }
+            break;
+        }
+        }
+    }
 
-        m_instructionSetFormat = single_data_swap;
-    } else if ((instruction & MASK_MULTIPLY) == MULTIPLY) {
+    // Fin du préfixe sans branchement : la suite du bloc est interprétée.
+    const MicroOp &last = block->ops[count - 1];
+    if (kindOf(last) != BRANCH && !(kindOf(last) == CALL && count == block->count && decoder::endsBasicBlock(last.instruction))) {
+        exit(block->start + count * 4, count, true);
+    }
 
-        m_instructionSetFormat = multiply;
-    } else if ((instruction & MASK_HALFWORD_DATA_TRANSFER_REGISTER_OFF) == HALFWORD_DATA_TRANSFER_REGISTER_OFF) {
+    for (const std::size_t label : spillExits) {
+        e.bind(label);
+    }
+    spill();
 
-        m_instructionSetFormat = halfword_data_transfer_register_off;
-    } else if ((instruction & MASK_MULTIPLY_LONG) == MULTIPLY_LONG) {
+    for (const std::size_t label : plainExits) {
+        e.bind(label);
+    }
+    e.adjustStack(8);
+    e.pop(R15);
+    e.pop(R14);
+    e.pop(R13);
+    e.pop(R12);
+    e.pop(RBP);
+    e.pop(RBX);
+    e.ret();
+
+    if (!m_code) {
+        m_code = std::make_unique<CodeBuffer>();
+    }
 
-        m_instructionSetFormat = multiply_long;
-    } else if ((instruction & MASK_HALFWORD_DATA_TRANSFER_IMMEDIATE_OFF) == HALFWORD_DATA_TRANSFER_IMMEDIATE_OFF) {
+    const void *code = m_code->append(e);
 
-        m_instructionSetFormat = halfword_data_transfer_immediate_off;
-    } else if ((instruction & MASK_COPROCESSOR_DATA_OPERATION) == COPROCESSOR_DATA_OPERATION) {
+    if (code == nullptr) {
 
-        m_instructionSetFormat = coprocessor_data_operation;
-    } else if ((instruction & MASK_COPROCESSOR_REGISTER_TRANSFER) == COPROCESSOR_REGISTER_TRANSFER) {
+        // Tampon plein : tout le code natif est oublié, les blocs seront retraduits.
+        m_code->reset();
+        m_blocks.retire();
+        return;
+    }
 
-        m_instructionSetFormat = coprocessor_register_transfer;
-    } else if ((instruction & MASK_SOFTWARE_INTERRUPT) == SOFTWARE_INTERRUPT) {
+    block->native      = reinterpret_cast<uint32_t (*)(void *, uint32_t *)>(const_cast<void *>(code));
+    block->nativeCount = count;
+}
 
-        m_instructionSetFormat = software_interrupt;
-    } else if ((instruction & MASK_UNDEFINED) == UNDEFINED) {
+#endif
 
-        m_instructionSetFormat = undefined;
-    } else if ((instruction & MASK_BLOCK_DATA_TRANSFER) == BLOCK_DATA_TRANSFER) {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+uint32_t Alu<MemoryHandler, CoproHandler, DispatchMode>::fetch() {
 
-        m_instructionSetFormat = block_data_transfer;
-    } else if ((instruction & MASK_BRANCH) == BRANCH) {
+    // PC avancé avant la lecture : une faute laisse m_pc à l'instruction suivante, comme dans un handler.
+    m_pc += 4;
 
-        m_instructionSetFormat = branch;
-    } else if ((instruction & MASK_COPROCESSOR_DATA_TRANSFER) == COPROCESSOR_DATA_TRANSFER) {
+    return m_mem->template readPointer<uint32_t>(m_pc - 4);
+}
 
-        m_instructionSetFormat = coprocessor_data_transfer;
-    } else if ((instruction & MASK_DATA_PROCESSING) == DATA_PROCESSING) {
+// Chaîne de masques, gardée comme référence de la table de décodage.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::decodev1(const uint32_t instruction) {
 
-        m_instructionSetFormat = data_processing;
-    } else if ((instruction & MASK_SINGLE_DATA_TRANSFER) == SINGLE_DATA_TRANSFER) {
+    m_workingInstruction   = instruction;
+    m_instructionSetFormat = decoder::decodeMaskChain(instruction);
 
-        m_instructionSetFormat = single_data_transfer;
-    } else {
+    if (m_instructionSetFormat == unknown) {
         armv4vm_assert(__FUNCTION__, __FILE__, __LINE__);
     }
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::evaluate() {
+// Une lecture de table indexée par les bits [27:20] et [7:4].
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::decodev2(const uint32_t instruction) {
+
+    m_workingInstruction   = instruction;
+    m_instructionSetFormat = decoder::decode(instruction);
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::evaluate() {
 
     switch (m_instructionSetFormat) {
 
@@ -429,6 +1467,243 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     }
 }
 
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+template <typename T>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::writeMemory(const uint32_t address, const T value) {
+
+    m_mem->template writePointer<T>(address) = value;
+
+    // Code auto-modifiant : les mots touchés seront décodés à nouveau.
+    if (m_predecode.isCode(address & ADDRESS_MASK)) [[unlikely]] {
+
+        if (m_predecode.invalidate(address & ADDRESS_MASK, sizeof(T))) {
+            invalidateBlocks();
+        }
+    }
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::invalidateBlocks() {
+
+    if (m_blocks.empty()) {
+        return;
+    }
+
+    // Le bloc courant s'arrête après l'écriture, la suite est retraduite.
+    m_blocks.retire();
+    m_blockEnd = nullptr;
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+typename Alu<MemoryHandler, CoproHandler, DispatchMode>::MicroOp
+Alu<MemoryHandler, CoproHandler, DispatchMode>::predecode(const uint32_t address, const uint32_t instruction) {
+
+    MicroOp op = {nullptr, instruction, 0, 0, 0, 0, 0, TARGET_HANDLER};
+
+    op.rd = static_cast<uint8_t>(BITS(instruction, 12, 15));
+    op.rn = static_cast<uint8_t>(BITS(instruction, 16, 19));
+    op.rm = static_cast<uint8_t>(BITS(instruction, 0, 3));
+
+    // Traitement générique de chaque format, dans l'ordre de FormatSummary.
+    static constexpr std::array<void (Alu::*)(const MicroOp &), unknown + 1> HANDLERS = {
+        &Alu::evalOp<&Alu::dataProcessingEval>,
+        &Alu::evalOp<&Alu::multiplyEval>,
+        &Alu::evalOp<&Alu::multiplyLongEval>,
+        &Alu::evalOp<&Alu::singleDataSwapEval>,
+        &Alu::evalOp<&Alu::branchAndExchangeEval>,
+        &Alu::evalOp<&Alu::halfwordDataTransferRegisterOffEval>,
+        &Alu::evalOp<&Alu::halfwordDataTransferImmediateOffEval>,
+        &Alu::evalOp<&Alu::singleDataTranferEval>,
+        &Alu::interpretOp,
+        &Alu::evalOp<&Alu::blockDataTransferEval>,
+        &Alu::evalOp<&Alu::branchEval>,
+        &Alu::evalOp<&Alu::coprocessorDataTransfers>,
+        &Alu::evalOp<&Alu::coprocessorDataOperations>,
+        &Alu::evalOp<&Alu::coprocessorRegisterTransfers>,
+        &Alu::evalOp<&Alu::softwareInterruptEval>,
+        &Alu::interpretOp,
+    };
+
+    const FormatSummary format = decoder::decode(instruction);
+    const bool          always = (instruction >> 28) == 0xE;
+
+    op.handler = HANDLERS[format];
+
+    // Formats les plus fréquents : opérandes précalculés.
+    switch (format) {
+
+    case data_processing:
+        if (instruction & 0x02000000) {
+
+            // § 4.5.3 : la rotation est connue au décodage. Sans rotation, la retenue vient du CPSR.
+            const uint32_t rotation = BITS(instruction, 8, 11) << 1;
+            const uint32_t value    = instruction & 0xFF;
+
+            op.operand = rotation ? (value >> rotation) | (value << (32 - rotation)) : value;
+            op.flags   = static_cast<uint8_t>(rotation ? op.operand >> 31 : 0x2);
+            op.handler = always ? &Alu::dataProcessingImmediateOp<false> : &Alu::dataProcessingImmediateOp<true>;
+            op.target  = always ? TARGET_DATA_PROCESSING_IMMEDIATE : TARGET_HANDLER;
+        } else if (BITS(instruction, 4, 11) == 0) {
+
+            // Registre sans décalage (LSL #0), le cas de mov rd, rm.
+            op.operand = op.rm == 15 ? 4 : 0;
+            op.handler = always ? &Alu::dataProcessingRegisterOp<false> : &Alu::dataProcessingRegisterOp<true>;
+            op.target  = always ? TARGET_DATA_PROCESSING_REGISTER : TARGET_HANDLER;
+        }
+        break;
+
+    case single_data_transfer:
+        // Offset immédiat : ldr/str rd, [rn, #offset]{!} et ldr/str rd, [rn], #offset
+        if ((instruction & 0x02000000) == 0) {
+
+            op.operand = instruction & 0x00800000 ? BITS(instruction, 0, 11) : 0u - BITS(instruction, 0, 11);
+            op.flags   = static_cast<uint8_t>(BITS(instruction, 20, 20) | (BITS(instruction, 22, 22) << 1) |
+                                            (BITS(instruction, 21, 21) << 2) | ((BITS(instruction, 24, 24) ^ 1) << 3));
+            op.handler = always ? &Alu::singleDataTransferImmediateOp<false> : &Alu::singleDataTransferImmediateOp<true>;
+            op.target  = always ? TARGET_SINGLE_DATA_TRANSFER_IMMEDIATE : TARGET_HANDLER;
+        }
+        break;
+
+    case branch:
+        op.operand = address + 4 + getSigned24(BITS(instruction, 0, 23) << 2) + 4;
+        op.flags   = static_cast<uint8_t>(BITS(instruction, 24, 24));
+        op.handler = always ? &Alu::branchOp<false> : &Alu::branchOp<true>;
+        op.target  = always ? TARGET_BRANCH : TARGET_HANDLER;
+        break;
+
+    default:
+        break;
+    }
+
+    return op;
+}
+
+// Page en lecture seule encore identique à l'image : décodée une fois pour toutes les ALU qui en partent. Les
+// autres restent privées et décodées à la demande.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+std::shared_ptr<typename PredecodeCache<typename Alu<MemoryHandler, CoproHandler, DispatchMode>::MicroOp>::Page>
+Alu<MemoryHandler, CoproHandler, DispatchMode>::lendPage(const uint32_t index) {
+
+    using Page = typename PredecodeCache<MicroOp>::Page;
+
+    const uint32_t address = index << PredecodeCache<MicroOp>::PAGE_BITS;
+
+    if (!m_mem->pageImage().pristine(address) || !m_mem->readOnlyPage(address)) {
+        return nullptr;
+    }
+
+    const MemoryImage &image = *m_mem->pageImage().source();
+
+    return m_sharedCode->page(index, [&image, address](Page &page) {
+
+        for (uint32_t i = 0; i < page.size(); i++) {
+
+            const std::size_t offset      = std::size_t{address} + i * 4;
+            uint32_t          instruction = 0;
+
+            if (offset + 4 <= image.size()) {
+                std::memcpy(&instruction, image.data() + offset, 4);
+            }
+
+            page[i] = predecode(static_cast<uint32_t>(offset), instruction);
+        }
+    });
+}
+
+// Première exécution d'une entrée du cache : décodage puis exécution.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::predecodeOp([[maybe_unused]] const MicroOp &op) {
+
+    const uint32_t address = m_pc - 4;
+    MicroOp       *entry   = m_predecode.entry(address);
+
+    *entry = predecode(address, m_mem->template readPointer<uint32_t>(address));
+    (this->*entry->handler)(*entry);
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+template <bool Conditional>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::dataProcessingImmediateOp(const MicroOp &op) {
+
+    if constexpr (Conditional) {
+        if (false == testCondition(op.instruction))
+            return;
+    }
+
+    dataProcessingExecute(op.instruction, op.operand, op.flags & 0x2 ? flagC() : op.flags);
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+template <bool Conditional>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::dataProcessingRegisterOp(const MicroOp &op) {
+
+    if constexpr (Conditional) {
+        if (false == testCondition(op.instruction))
+            return;
+    }
+
+    dataProcessingExecute(op.instruction, m_registers[op.rm] + op.operand, flagC());
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+template <bool Conditional>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::singleDataTransferImmediateOp(const MicroOp &op) {
+
+    enum { LOAD = 0x1, BYTE = 0x2, WRITE_BACK = 0x4, POST_INDEXED = 0x8 };
+
+    if constexpr (Conditional) {
+        if (false == testCondition(op.instruction))
+            return;
+    }
+
+    // § 4.9.4
+    const uint32_t base    = m_registers[op.rn] + (op.rn != 15 ? 0 : 4);
+    const uint32_t address = op.flags & POST_INDEXED ? base : base + op.operand;
+
+    switch (op.flags & (LOAD | BYTE)) {
+
+    case LOAD:
+        m_registers[op.rd] = m_mem->template readPointer<uint32_t>(address);
+        break;
+
+    case LOAD | BYTE:
+        m_registers[op.rd] = m_mem->template readPointer<uint32_t>(address) & 0x000000FF;
+        break;
+
+    case BYTE:
+        writeMemory<uint8_t>(address, static_cast<uint8_t>(m_registers[op.rd] + (op.rd != 15 ? 0 : 8)));
+        break;
+
+    default:
+        writeMemory<uint32_t>(address, m_registers[op.rd] + (op.rd != 15 ? 0 : 8));
+        break;
+    }
+
+    // § 4.9.1 : en post-indexé, le write back est toujours effectué.
+    if (op.flags & (WRITE_BACK | POST_INDEXED)) {
+
+        m_registers[op.rn] = base + op.operand;
+    }
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+template <bool Conditional>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::branchOp(const MicroOp &op) {
+
+    if constexpr (Conditional) {
+        if (false == testCondition(op.instruction))
+            return;
+    }
+
+    if (op.flags) {
+
+        // § 4.4.1
+        m_lr = m_pc;
+    }
+
+    m_pc = op.operand;
+}
+
 #define POS(i) ((~(i)) >> 31)
 #define NEG(i) ((i) >> 31)
 
@@ -452,7 +1727,70 @@ inline static bool isCarryFromALUSub(const uint32_t op1, const uint32_t op2, con
     return ((NEG(op1) && POS(op2)) || (NEG(op1) && POS(result)) || (POS(op2) && POS(result)));
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::dataProcessingEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+bool Alu<MemoryHandler, CoproHandler, DispatchMode>::flagC() const {
+
+    return m_cpsr & 0x20000000;
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::setLogicalFlags(const uint32_t result, const uint32_t carry) {
+
+    result & 0x80000000 ? setN() : unsetN();
+    result ? unsetZ() : setZ();
+    carry ? setC() : unsetC();
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::setArithmeticFlags(const FlagsKind kind, const uint32_t operand1,
+                                                                        const uint32_t operand2, const uint32_t result) {
+
+    const bool add = kind == FLAGS_ADD;
+
+    result & 0x80000000 ? setN() : unsetN();
+    result ? unsetZ() : setZ();
+    (add ? isCarryFromALUAdd(operand1, operand2, result) : isCarryFromALUSub(operand1, operand2, result)) ? setC()
+                                                                                                          : unsetC();
+    (add ? isOverflowAdd(operand1, operand2, result) : isOverflowSub(operand1, operand2, result)) ? setV() : unsetV();
+}
+
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::dataProcessingEval() {
+
+           // clang-format off
+    struct DataProcessing {
+
+        uint32_t operand2  : 12;
+        uint32_t rd        :  4;
+        uint32_t rn        :  4;
+        uint32_t s         :  1;
+        uint32_t opcode    :  4;
+        uint32_t immediate :  1;
+        uint32_t           :  2;
+        uint32_t condition :  4;
+
+    } instruction;
+    // clang-format on
+
+    uint32_t carryFromShifter = 0;
+    uint32_t operand2         = 0;
+
+    if (false == testCondition(m_workingInstruction))
+        return;
+
+    instruction      = cast<DataProcessing>(m_workingInstruction);
+    carryFromShifter = 0;
+
+    operand2 = instruction.immediate ? rotate(instruction.operand2, carryFromShifter) : shift(instruction.operand2, carryFromShifter);
+
+    dataProcessingExecute(m_workingInstruction, operand2, carryFromShifter);
+}
+
+// Partie commune à l'interpréteur et aux micro-ops : operand2 est déjà évalué.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::dataProcessingExecute(const uint32_t workingInstruction,
+                                                             const uint32_t operand2,
+                                                             const uint32_t carryFromShifter) {
 
     enum OpCode {
 
@@ -475,7 +1813,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     };
 
            // clang-format off
-    static struct DataProcessing {
+    struct DataProcessing {
 
         uint32_t operand2  : 12;
         uint32_t rd        :  4;
@@ -489,25 +1827,13 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     } instruction;
     // clang-format on
 
-           // DataProcessing instruction;
-    static uint32_t operand1         = 0;
-    static uint32_t operand2         = 0;
-    static uint32_t carryFromShifter = 0;
-    static bool     carryFromALU     = 0;
-    static uint32_t notWrittenResult = 0;
-    bool            overflow         = false;
+    uint32_t operand1         = 0;
+    uint32_t notWrittenResult = 0;
 
-    if (false == testCondition(m_workingInstruction))
-        return;
-
-    instruction      = cast<DataProcessing>(m_workingInstruction);
-    carryFromALU     = 0;
-    carryFromShifter = 0;
-    overflow         = false;
+    instruction  = cast<DataProcessing>(workingInstruction);
 
            // § 4.5.5
     operand1 = m_registers[instruction.rn] + (instruction.rn != 15 ? 0 : 4);
-    operand2 = instruction.immediate ? rotate(instruction.operand2, carryFromShifter) : shift(instruction.operand2, carryFromShifter);
 
     switch (instruction.opcode) {
 
@@ -521,38 +1847,26 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
 
     case SUB:
         m_registers[instruction.rd] = operand1 - operand2;
-        carryFromALU = isCarryFromALUSub(operand1, operand2, m_registers[instruction.rd]);
-        overflow     = isOverflowSub(operand1, operand2, m_registers[instruction.rd]);
         break;
 
     case RSB:
         m_registers[instruction.rd] = operand2 - operand1;
-        carryFromALU                = isCarryFromALUSub(operand2, operand1, m_registers[instruction.rd]);
-        overflow                    = isOverflowSub(operand2, operand1, m_registers[instruction.rd]);
         break;
 
     case ADD:
         m_registers[instruction.rd] = operand1 + operand2;
-        carryFromALU                = isCarryFromALUAdd(operand1, operand2, m_registers[instruction.rd]);
-        overflow                    = isOverflowAdd(operand1, operand2, m_registers[instruction.rd]);
         break;
 
     case ADC:
-        m_registers[instruction.rd] = operand1 + operand2 + ((m_cpsr >> 29) & 0x1);
-        carryFromALU                = isCarryFromALUAdd(operand1, operand2, m_registers[instruction.rd]);
-        overflow                    = isOverflowAdd(operand1, operand2, m_registers[instruction.rd]);
+        m_registers[instruction.rd] = operand1 + operand2 + flagC();
         break;
 
     case SBC:
-        m_registers[instruction.rd] = operand1 - operand2 + ((m_cpsr >> 29) & 0x1) - 1;
-        carryFromALU                = isCarryFromALUSub(operand1, operand2, m_registers[instruction.rd]);
-        overflow                    = isOverflowSub(operand1, operand2, m_registers[instruction.rd]);
+        m_registers[instruction.rd] = operand1 - operand2 + flagC() - 1;
         break;
 
     case RSC:
-        m_registers[instruction.rd] = operand2 - operand1 + ((m_cpsr >> 29) & 0x1) - 1;
-        carryFromALU                = isCarryFromALUSub(operand2, operand1, m_registers[instruction.rd]);
-        overflow                    = isOverflowSub(operand2, operand1, m_registers[instruction.rd]);
+        m_registers[instruction.rd] = operand2 - operand1 + flagC() - 1;
         break;
 
     case TST:
@@ -573,8 +1887,6 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
 
     case CMP:
         notWrittenResult = operand1 - operand2;
-        carryFromALU     = isCarryFromALUSub(operand1, operand2, notWrittenResult);
-        overflow         = isOverflowSub(operand1, operand2, notWrittenResult);
 #ifdef DEBUG
         if(instruction.s == 0)
             armv4vm_assert(__FUNCTION__, __FILE__, __LINE__);
@@ -583,8 +1895,6 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
 
     case CMN:
         notWrittenResult = operand1 + operand2;
-        carryFromALU     = isCarryFromALUAdd(operand1, operand2, notWrittenResult);
-        overflow         = isOverflowAdd(operand1, operand2, notWrittenResult);
 #ifdef DEBUG
         if(instruction.s == 0)
             armv4vm_assert(__FUNCTION__, __FILE__, __LINE__);
@@ -622,6 +1932,9 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
             armv4vm_assert(__FUNCTION__, __FILE__, __LINE__);
         }
 #endif
+        const uint32_t result =
+            instruction.opcode >= TST && instruction.opcode <= CMN ? notWrittenResult : m_registers[instruction.rd];
+
         switch (instruction.opcode) {
 
         // LOGICAL
@@ -631,37 +1944,27 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
         case MOV:
         case BIC:
         case MVN:
-            m_registers[instruction.rd] & 0x80000000 ? setN() : unsetN();
-            m_registers[instruction.rd] ? unsetZ() : setZ();
-            carryFromShifter ? setC() : unsetC();
-            break;
-
         case TST:
         case TEQ:
-            notWrittenResult & 0x80000000 ? setN() : unsetN();
-            notWrittenResult ? unsetZ() : setZ();
-            carryFromShifter ? setC() : unsetC();
+            setLogicalFlags(result, carryFromShifter);
             break;
 
                    // ARITHMETIC
-        case RSC:
-        case SUB:
-        case RSB:
         case ADD:
         case ADC:
-        case SBC:
-            m_registers[instruction.rd] & 0x80000000 ? setN() : unsetN();
-            m_registers[instruction.rd] ? unsetZ() : setZ();
-            carryFromALU ? setC() : unsetC();
-            overflow ? setV() : unsetV();
+        case CMN:
+            setArithmeticFlags(FLAGS_ADD, operand1, operand2, result);
             break;
 
+        case SUB:
+        case SBC:
         case CMP:
-        case CMN:
-            notWrittenResult & 0x80000000 ? setN() : unsetN();
-            notWrittenResult ? unsetZ() : setZ();
-            carryFromALU ? setC() : unsetC();
-            overflow ? setV() : unsetV();
+            setArithmeticFlags(FLAGS_SUB, operand1, operand2, result);
+            break;
+
+        case RSB:
+        case RSC:
+            setArithmeticFlags(FLAGS_SUB, operand2, operand1, result);
             break;
 
         default:
@@ -671,7 +1974,8 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     }
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::multiplyEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::multiplyEval() {
 
     // clang-format off
 
@@ -720,11 +2024,11 @@ inline static int64_t  signedCastTo64(const uint32_t value) { return static_cast
 inline static uint64_t unsignedCastTo64(const uint32_t value) { return static_cast<uint64_t>(value); }
 
 
-template <typename MemoryHandler, typename CoproHandler>
-void Alu<MemoryHandler, CoproHandler>::multiplyLongEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::multiplyLongEval() {
 
     // clang-format off
-    static struct MultiplyLong {
+    struct MultiplyLong {
 
         uint32_t rm        : 4;
         uint32_t           : 4;
@@ -785,10 +2089,11 @@ void Alu<MemoryHandler, CoproHandler>::multiplyLongEval() {
     }
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::singleDataTranferEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::singleDataTranferEval() {
 
     // clang-format off
-    static struct SingleDataTranfer {
+    struct SingleDataTranfer {
 
         uint32_t offset    : 12;
         uint32_t rd        :  4;
@@ -805,11 +2110,11 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     } instruction;
     // clang-format on
 
-    static uint32_t offset = 0;
-    static uint32_t carry  = 0;
-    static uint32_t value  = 0;
-    static uint32_t rd     = 0;
-    static uint32_t rn     = 0;
+    uint32_t offset = 0;
+    uint32_t carry  = 0;
+    uint32_t value  = 0;
+    uint32_t rd     = 0;
+    uint32_t rn     = 0;
 
     if (false == testCondition(m_workingInstruction))
         return;
@@ -902,14 +2207,14 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
 
                 if (instruction.u) {
 
-                    m_mem->template writePointer<uint8_t>(rn + offset) = static_cast<uint8_t>(value);
+                    writeMemory<uint8_t>(rn + offset, static_cast<uint8_t>(value));
                     if (instruction.w) {
 
                         m_registers[instruction.rn] = rn + offset;
                     }
                 } else {
 
-                    m_mem->template writePointer<uint8_t>(rn - offset) = static_cast<uint8_t>(value);
+                    writeMemory<uint8_t>(rn - offset, static_cast<uint8_t>(value));
                     if (instruction.w) {
 
                         m_registers[instruction.rn] = rn - offset;
@@ -917,7 +2222,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                 }
             } else {
 
-                m_mem->template writePointer<uint8_t>(rn) = static_cast<uint8_t>(value);
+                writeMemory<uint8_t>(rn, static_cast<uint8_t>(value));
 
                 if (instruction.u) {
 
@@ -933,14 +2238,14 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
 
                 if (instruction.u) {
 
-                    m_mem->template writePointer<uint32_t>(rn + offset) = rd;
+                    writeMemory<uint32_t>(rn + offset, rd);
                     if (instruction.w) {
 
                         m_registers[instruction.rn] = rn + offset;
                     }
                 } else {
 
-                    m_mem->template writePointer<uint32_t>(rn - offset) = rd;
+                    writeMemory<uint32_t>(rn - offset, rd);
                     if (instruction.w) {
 
                         m_registers[instruction.rn] = rn - offset;
@@ -948,7 +2253,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                 }
             } else {
 
-                m_mem->template writePointer<uint32_t>(rn) = rd;
+                writeMemory<uint32_t>(rn, rd);
 
                 if (instruction.u) {
 
@@ -967,10 +2272,11 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
            // retained by setting the offset to zero.
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::branchAndExchangeEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::branchAndExchangeEval() {
 
     // clang-format off
-    static struct BranchAndExchange {
+    struct BranchAndExchange {
 
         uint32_t rn        :  4;
         uint32_t           : 24;
@@ -989,10 +2295,11 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     m_pc = m_registers[instruction.rn];
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::branchEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::branchEval() {
 
     // clang-format off
-    static struct Branch {
+    struct Branch {
 
         uint32_t offset    : 24; // Signed ! §4.4
         uint32_t l         :  1;
@@ -1016,7 +2323,8 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     m_pc += getSigned24((instruction.offset) << 2) + 4;
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::blockDataTransferEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::blockDataTransferEval() {
 
     union BlockDatatransfer {
         struct __attribute__((packed)) {
@@ -1043,8 +2351,8 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     //instruction =  *reinterpret_cast<BlockDatatransfer *>(&m_workingInstruction); //memcpy
     //std::cout << "thierry2 " << instruction.registerList << " " << instruction.value << std::endl;
 
-    static uint32_t offset = 0;
-    static std::array<uint32_t, 16>::size_type i = 0;
+    uint32_t offset = 0;
+    std::array<uint32_t, 16>::size_type i = 0;
     //int i = 0;
 
     if (false == testCondition(m_workingInstruction))
@@ -1128,7 +2436,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                     if (instruction.registerList & (1 << i)) {
 
                         offset += 4;
-                        m_mem->template writePointer<uint32_t>(offset) = m_registers[i];
+                        writeMemory<uint32_t>(offset, m_registers[i]);
                     }
                 }
 
@@ -1136,7 +2444,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                 if (instruction.registerList & 0x8000) {
 
                     offset += 4;
-                    m_mem->template writePointer<uint32_t>(offset) = m_registers[15] + 4; // et pas + 12
+                    writeMemory<uint32_t>(offset, m_registers[15] + 4); // et pas + 12
                 }
             } else {
 
@@ -1145,7 +2453,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
 
                     if (instruction.registerList & (1 << i)) {
 
-                        m_mem->template writePointer<uint32_t>(offset) = m_registers[i];
+                        writeMemory<uint32_t>(offset, m_registers[i]);
                         offset += 4;
                     }
                 }
@@ -1153,7 +2461,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                        // Registre 15
                 if (instruction.registerList & 0x8000) {
 
-                    m_mem->template writePointer<uint32_t>(offset) = m_registers[15] + 4;
+                    writeMemory<uint32_t>(offset, m_registers[15] + 4);
                     offset += 4;
                 }
             }
@@ -1167,7 +2475,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
 
                     offset -= 4;
                     // m_mem->template readPointer<uint32_t>(offset) = m_registers[15] + 4;
-                    m_mem->template writePointer<uint32_t>(offset) = m_registers[15] + 4;
+                    writeMemory<uint32_t>(offset, m_registers[15] + 4);
                 }
 
                        // Registre 14, 13, 12, ...
@@ -1176,7 +2484,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                     if (instruction.registerList & (1 << i)) {
 
                         offset -= 4;
-                        m_mem->template writePointer<uint32_t>(offset) = m_registers[i];
+                        writeMemory<uint32_t>(offset, m_registers[i]);
                     }
                 }
             } else {
@@ -1185,7 +2493,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                        // Registre 15
                 if (instruction.registerList & 0x8000) {
 
-                    m_mem->template writePointer<uint32_t>(offset) = m_registers[15] + 4;
+                    writeMemory<uint32_t>(offset, m_registers[15] + 4);
                     offset -= 4;
                 }
 
@@ -1195,7 +2503,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                     if (instruction.registerList & (1 << i)) {
 
                         //m_registers[i]                         = m_mem->template readPointer<uint32_t>(offset);
-                        m_mem->template writePointer<uint32_t>(offset) = m_registers[i];
+                        writeMemory<uint32_t>(offset, m_registers[i]);
                         offset -= 4;
                     }
                 }
@@ -1217,7 +2525,8 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     }
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::halfwordDataTransferRegisterOffEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::halfwordDataTransferRegisterOffEval() {
 
     // clang-format off
     struct HalfWordDataTransferRegisterOffset {
@@ -1325,7 +2634,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                 offset += 2;
             }
 
-            m_mem->template writePointer<uint32_t>(offset) = (rd & 0x0000FFFF) | (rd << 16);
+            writeMemory<uint32_t>(offset, (rd & 0x0000FFFF) | (rd << 16));
 
             if (instruction.w) {
 
@@ -1333,7 +2642,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
             }
         } else {
 
-            m_mem->template writePointer<uint32_t>(offset) = (rd & 0x0000FFFF) | (rd << 16);
+            writeMemory<uint32_t>(offset, (rd & 0x0000FFFF) | (rd << 16));
 
             if (instruction.u)
                 offset = offset + m_registers[instruction.rm];
@@ -1350,7 +2659,8 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     }
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::halfwordDataTransferImmediateOffEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::halfwordDataTransferImmediateOffEval() {
 
     // clang-format off
     struct HalfWordDataTransferImmediateOffset {
@@ -1374,7 +2684,7 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     } instruction;
     // clang-format on
 
-    static uint32_t offset;
+    uint32_t offset = 0;
 
     if (false == testCondition(m_workingInstruction))
         return;
@@ -1448,11 +2758,11 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
                 offset = offset - ((instruction.offset2 << 4) | instruction.offset1);
 
             if((offset % 4) == 0)
-                m_mem->template writePointer<uint32_t>(offset) =
-                    (m_mem->template readPointer<uint32_t>(offset) & 0xFFFF0000) | (rd & 0x0000FFFF);
+                writeMemory<uint32_t>(offset,
+                    (m_mem->template readPointer<uint32_t>(offset) & 0xFFFF0000) | (rd & 0x0000FFFF));
             else
-                m_mem->template writePointer<uint32_t>(offset - 2) =
-                    (m_mem->template readPointer<uint32_t>(offset - 2) & 0x0000FFFF) | (rd << 16);
+                writeMemory<uint32_t>(offset - 2,
+                    (m_mem->template readPointer<uint32_t>(offset - 2) & 0x0000FFFF) | (rd << 16));
 
             if (instruction.w) {
 
@@ -1465,11 +2775,11 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
         } else {
 
             if((offset % 4) == 0)
-                m_mem->template writePointer<uint32_t>(offset) =
-                    (m_mem->template readPointer<uint32_t>(offset) & 0xFFFF0000) | (rd & 0x0000FFFF);
+                writeMemory<uint32_t>(offset,
+                    (m_mem->template readPointer<uint32_t>(offset) & 0xFFFF0000) | (rd & 0x0000FFFF));
             else
-                m_mem->template writePointer<uint32_t>(offset - 2) =
-                    (m_mem->template readPointer<uint32_t>(offset) & 0x0000FFFF) | (rd << 16);
+                writeMemory<uint32_t>(offset - 2,
+                    (m_mem->template readPointer<uint32_t>(offset) & 0x0000FFFF) | (rd << 16));
 
             if (instruction.u)
                 offset = offset + ((instruction.offset2 << 4) | instruction.offset1);
@@ -1486,7 +2796,8 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     }
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::softwareInterruptEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::softwareInterruptEval() {
 
     // clang-format off
     struct SoftwareInterrupt {
@@ -1503,10 +2814,31 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
 
     instruction = cast<SoftwareInterrupt>(m_workingInstruction);
 
-    throw AluException(static_cast<Interrupt>(instruction.comment));
+    // Appel direct de l'hôte : la boucle continue sauf s'il rend la main. Une MemoryFaultException de load/store
+    // remonte à la boucle, qui signale la faute sur le swi.
+    if (instruction.comment < m_swiHandlers.size() && m_swiHandlers[instruction.comment]) {
+
+        SwiAction action;
+
+        if constexpr (MemoryHandler::HOST_FAULTS) {
+            typename MemoryHandler::Unguard unguard;
+            action = m_swiHandlers[instruction.comment]();
+        } else {
+            action = m_swiHandlers[instruction.comment]();
+        }
+
+        if (action == SwiAction::Continue) {
+            return;
+        }
+    }
+
+    // Pas d'exception : la boucle de run() s'arrête sur m_running.
+    m_interrupt = static_cast<Interrupt>(instruction.comment);
+    m_running   = false;
 }
 
-template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler, CoproHandler>::singleDataSwapEval() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::singleDataSwapEval() {
 
     // clang-format off
     struct SingleDataSwap {
@@ -1532,18 +2864,18 @@ template <typename MemoryHandler, typename CoproHandler> void Alu<MemoryHandler,
     if(instruction.b == 0) {
 
         const uint32_t copy = m_mem->template readPointer<uint32_t>(m_registers[instruction.rn]);
-        m_mem->template writePointer<uint32_t>(m_registers[instruction.rn]) = m_registers[instruction.rm];
+        writeMemory<uint32_t>(m_registers[instruction.rn], m_registers[instruction.rm]);
         m_registers[instruction.rd] = copy;
     }
     else {
         const uint8_t copy = m_mem->template readPointer<uint8_t>(m_registers[instruction.rn]);
-        m_mem->template writePointer<uint8_t>(m_registers[instruction.rn]) = m_registers[instruction.rm];
+        writeMemory<uint8_t>(m_registers[instruction.rn], static_cast<uint8_t>(m_registers[instruction.rm]));
         m_registers[instruction.rd] = copy;
     }
 }
 
-template <typename MemoryHandler, typename CoproHandler>
-void Alu<MemoryHandler, CoproHandler>::coprocessorDataTransfers() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::coprocessorDataTransfers() {
 
     if (false == testCondition(m_workingInstruction))
         return;
@@ -1551,8 +2883,8 @@ void Alu<MemoryHandler, CoproHandler>::coprocessorDataTransfers() {
     m_coprocessor->coprocessorDataTransfers(m_workingInstruction);
 }
 
-template <typename MemoryHandler, typename CoproHandler>
-void Alu<MemoryHandler, CoproHandler>::coprocessorDataOperations() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::coprocessorDataOperations() {
 
     if (false == testCondition(m_workingInstruction))
         return;
@@ -1560,8 +2892,8 @@ void Alu<MemoryHandler, CoproHandler>::coprocessorDataOperations() {
     m_coprocessor->coprocessorDataOperations(/*m_mem, */m_workingInstruction);
 }
 
-template <typename MemoryHandler, typename CoproHandler>
-void Alu<MemoryHandler, CoproHandler>::coprocessorRegisterTransfers() {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+void Alu<MemoryHandler, CoproHandler, DispatchMode>::coprocessorRegisterTransfers() {
 
     if (false == testCondition(m_workingInstruction))
         return;
@@ -1569,94 +2901,27 @@ void Alu<MemoryHandler, CoproHandler>::coprocessorRegisterTransfers() {
     m_coprocessor->coprocessorRegisterTransfers(/*m_mem, */m_workingInstruction);
 }
 
-template <typename MemoryHandler, typename CoproHandler>
-bool Alu<MemoryHandler, CoproHandler>::testCondition(const uint32_t instruction) const {
-
-    // N Z C V . . . . . .
-    enum ConditionCode {
-
-        EQ = 0x0,
-        NE = 0x1,
-        CS = 0x2,
-        CC = 0x3,
-        MI = 0x4,
-        PL = 0x5,
-        VS = 0x6,
-        VC = 0x7,
-        HI = 0x8,
-        LS = 0x9,
-        GE = 0xA,
-        LT = 0xB,
-        GT = 0xC,
-        LE = 0xD,
-        AL = 0xE
-    };
-
-    switch (instruction >> 28) {
-
-    case AL:
-        return true;
+// § 4.2 - Une ligne de la table par condition, un bit par valeur de NZCV : un décalage et un test de bit.
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+bool Alu<MemoryHandler, CoproHandler, DispatchMode>::testCondition(const uint32_t instruction) const {
 
-    case EQ: // Z==1
-        return ((m_cpsr >> 28) & 0x4) == 0x4;
-
-    case NE: // Z==0
-        return ((m_cpsr >> 28) & 0x4) == 0x0;
-
-    case CS: // C==1
-        return ((m_cpsr >> 28) & 0x2) == 0x2;
-
-    case CC: // C==0
-        return ((m_cpsr >> 28) & 0x2) == 0x0;
-
-    case MI: // N==1
-        return ((m_cpsr >> 28) & 0x8) == 0x8;
-
-    case PL: // N==0
-        return ((m_cpsr >> 28) & 0x8) == 0x0;
-
-    case VS: // V==1
-        return ((m_cpsr >> 28) & 0x1) == 0x1;
-
-    case VC: // V==0
-        return ((m_cpsr >> 28) & 0x1) == 0x0;
-
-    case HI:                                  // (Z==0) && (C==1)
-        return ((m_cpsr >> 28) & 0x6) == 0x2; // relu
-
-    case LS: // (Z==1) || (C==0)
-        return (((m_cpsr >> 28) & 0x4) == 0x4) || (((m_cpsr >> 28) & 0x2) == 0x0);
-
-    case GE: // N==V
-        return ((m_cpsr >> 31) & 0x1) == ((m_cpsr >> 28) & 0x1);
-
-    case LT: // N!=V
-        return ((m_cpsr >> 31) & 0x1) != ((m_cpsr >> 28) & 0x1);
-
-    case GT: // (Z==0) && (N==V)
-        return (((m_cpsr >> 28) & 0x4) == 0x0) && (((m_cpsr >> 31) & 0x1) == ((m_cpsr >> 28) & 0x1));
-
-    case LE: // (Z==1) || (N!=V)
-        return (((m_cpsr >> 28) & 0x4) == 0x4) || (((m_cpsr >> 31) & 0x1) != ((m_cpsr >> 28) & 0x1));
-
-    default: // What the hell is going on ?
-        armv4vm_assert(__FUNCTION__, __FILE__, __LINE__);
-        return false;
-    }
+    return (decoder::CONDITION_TABLE[instruction >> 28] >> (m_cpsr >> 28)) & 0x1;
 }
 
-template <typename MemoryHandler, typename CoproHandler> uint32_t Alu<MemoryHandler, CoproHandler>::rotate(const uint32_t operand2, uint32_t &carry) const {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+uint32_t Alu<MemoryHandler, CoproHandler, DispatchMode>::rotate(const uint32_t operand2, uint32_t &carry) const {
 
     // § 4.5.3
     // On shift de 7 et pas de 8 pour multiplier par 2 la valeur de rotation.
 
     uint32_t result = (operand2 & 0xFF) << (32 - ((operand2 & 0xF00) >> 7)) | (operand2 & 0xFF) >> ((operand2 & 0xF00) >> 7);
-    carry = operand2 & 0xF00 ? result & 0x80000000 : m_cpsr & 0x20000000;
+    carry = operand2 & 0xF00 ? result & 0x80000000 : flagC();
 
     return result;
 }
 
-template <typename MemoryHandler, typename CoproHandler> uint32_t Alu<MemoryHandler, CoproHandler>::shift(const uint32_t operand2, uint32_t &carry) const {
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+uint32_t Alu<MemoryHandler, CoproHandler, DispatchMode>::shift(const uint32_t operand2, uint32_t &carry) const {
 
     uint32_t              shiftResult     = 0;
     uint32_t              shiftValue      = 0;
@@ -1702,7 +2967,7 @@ template <typename MemoryHandler, typename CoproHandler> uint32_t Alu<MemoryHand
         } else if (shiftValue == 0) {
 
             shiftResult = value;
-            carry       = m_cpsr & 0x20000000;
+            carry       = flagC();
         } else {
 
             shiftResult = value << shiftValue;
@@ -1773,7 +3038,7 @@ template <typename MemoryHandler, typename CoproHandler> uint32_t Alu<MemoryHand
         } else {
 
             // Rotate Right Extended
-            shiftResult = ((m_cpsr & 0x20000000) << 2) | (value >> 1);
+            shiftResult = (static_cast<uint32_t>(flagC()) << 31) | (value >> 1);
             carry       = value & 0x1;
         }
         break;
@@ -1793,8 +3058,8 @@ inline void AluBase::setCPSR(const uint32_t cpsr) {
     m_cpsr = cpsr;
 }
 
-template <typename MemoryHandler, typename CoproHandler>
-Alu<MemoryHandler, CoproHandler>::~Alu() { }
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode>
+Alu<MemoryHandler, CoproHandler, DispatchMode>::~Alu() { }
 
 //} // namespace armv4vm
 
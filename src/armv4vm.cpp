@@ -26,6 +26,21 @@ template class NullCopro<MemoryProtected>;
 
 template class Alu<MemoryRaw, NullCoproUnsafe>;
 template class Alu<MemoryProtected, NullCoproSafe>;
+template class Alu<MemoryRaw, NullCoproUnsafe, Dispatch::THREADED>;
+template class Alu<MemoryProtected, NullCoproSafe, Dispatch::THREADED>;
+
+template class NullCopro<MemoryMasked1M>;
+template class NullCopro<MemoryMasked32M>;
+template class Alu<MemoryMasked1M, NullCopro<MemoryMasked1M>>;
+template class Alu<MemoryMasked32M, NullCopro<MemoryMasked32M>>;
+template class Alu<MemoryMasked1M, NullCopro<MemoryMasked1M>, Dispatch::THREADED>;
+template class Alu<MemoryMasked32M, NullCopro<MemoryMasked32M>, Dispatch::THREADED>;
+
+#if ARMV4VM_GUARDED
+template class NullCopro<MemoryGuarded>;
+template class Alu<MemoryGuarded, NullCopro<MemoryGuarded>>;
+template class Alu<MemoryGuarded, NullCopro<MemoryGuarded>, Dispatch::THREADED>;
+#endif
 
 } // namespace armv4vm
 
@@ -20,6 +20,10 @@
 #include "armv4vm_p.hpp"        // IWYU pragma: export
 #include "properties.hpp"       // IWYU pragma: export
 #include "memoryhandler.hpp"    // IWYU pragma: export
+#include "memoryguarded.hpp"    // IWYU pragma: export
+#include "memorymasked.hpp"     // IWYU pragma: export
+#include "elf.hpp"              // IWYU pragma: export
+#include "programcache.hpp"     // IWYU pragma: export
 #include "nullcopro.hpp"        // IWYU pragma: export
 #include "alu.hpp"              // IWYU pragma: export
 #include "vm.hpp"               // IWYU pragma: export
@@ -40,5 +44,23 @@ extern template class armv4vm::NullCopro<armv4vm::MemoryProtected>;
 
 extern template class armv4vm::Alu<armv4vm::MemoryRaw, NullCoproUnsafe>;
 extern template class armv4vm::Alu<armv4vm::MemoryProtected, NullCoproSafe>;
+extern template class armv4vm::Alu<armv4vm::MemoryRaw, NullCoproUnsafe, armv4vm::Dispatch::THREADED>;
+extern template class armv4vm::Alu<armv4vm::MemoryProtected, NullCoproSafe, armv4vm::Dispatch::THREADED>;
+
+extern template class armv4vm::NullCopro<armv4vm::MemoryMasked1M>;
+extern template class armv4vm::NullCopro<armv4vm::MemoryMasked32M>;
+extern template class armv4vm::Alu<armv4vm::MemoryMasked1M, armv4vm::NullCopro<armv4vm::MemoryMasked1M>>;
+extern template class armv4vm::Alu<armv4vm::MemoryMasked32M, armv4vm::NullCopro<armv4vm::MemoryMasked32M>>;
+extern template class armv4vm::Alu<armv4vm::MemoryMasked1M, armv4vm::NullCopro<armv4vm::MemoryMasked1M>,
+                                   armv4vm::Dispatch::THREADED>;
+extern template class armv4vm::Alu<armv4vm::MemoryMasked32M, armv4vm::NullCopro<armv4vm::MemoryMasked32M>,
+                                   armv4vm::Dispatch::THREADED>;
+
+#if ARMV4VM_GUARDED
+extern template class armv4vm::NullCopro<armv4vm::MemoryGuarded>;
+extern template class armv4vm::Alu<armv4vm::MemoryGuarded, armv4vm::NullCopro<armv4vm::MemoryGuarded>>;
+extern template class armv4vm::Alu<armv4vm::MemoryGuarded, armv4vm::NullCopro<armv4vm::MemoryGuarded>,
+                                   armv4vm::Dispatch::THREADED>;
+#endif
 
 #endif
@@ -17,9 +17,11 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <cassert>
+#include <functional>
 
 // todo : traiter les overflow
 constexpr std::uint64_t operator""_kb(const unsigned long long value) {
@@ -65,6 +67,68 @@ enum class Interrupt : int32_t {
     UnlockPush = 7,
     Fatal      = 8,
     Undefined  = 9,
+    Return     = 10, // trampoline de Vm::call() : la fonction appelée est revenue
+    Hle        = 11, // première instruction d'une routine remplacée par l'hôte (VmProperties::m_hle)
+};
+
+// Routines de la bibliothèque C et de libgcc que l'hôte sait exécuter à la place de l'invité.
+enum class HleRoutine {
+    Memcpy,   // memcpy
+    Memset,   // memset
+    Strlen,   // strlen
+    Idiv,     // __aeabi_idiv, __divsi3
+    Uidiv,    // __aeabi_uidiv, __udivsi3
+    Idivmod,  // __aeabi_idivmod
+    Uidivmod, // __aeabi_uidivmod
+    // Virgule flottante logicielle de libgcc (ieee754-df.S, ieee754-sf.S), calculée en IEEE 754 par l'hôte
+    Dadd,     // __aeabi_dadd, __adddf3
+    Dsub,     // __aeabi_dsub, __subdf3
+    Drsub,    // __aeabi_drsub
+    Dmul,     // __aeabi_dmul, __muldf3
+    Ddiv,     // __aeabi_ddiv, __divdf3
+    Dcmpeq,   // __aeabi_dcmpeq
+    Dcmplt,   // __aeabi_dcmplt
+    Dcmple,   // __aeabi_dcmple
+    Dcmpge,   // __aeabi_dcmpge
+    Dcmpgt,   // __aeabi_dcmpgt
+    Dcmpun,   // __aeabi_dcmpun, __unorddf2
+    I2d,      // __aeabi_i2d, __floatsidf
+    Ui2d,     // __aeabi_ui2d, __floatunsidf
+    L2d,      // __aeabi_l2d, __floatdidf
+    Ul2d,     // __aeabi_ul2d, __floatundidf
+    F2d,      // __aeabi_f2d, __extendsfdf2
+    D2f,      // __aeabi_d2f, __truncdfsf2
+    D2iz,     // __aeabi_d2iz, __fixdfsi
+    D2uiz,    // __aeabi_d2uiz, __fixunsdfsi
+    Fadd,     // __aeabi_fadd, __addsf3
+    Fsub,     // __aeabi_fsub, __subsf3
+    Frsub,    // __aeabi_frsub
+    Fmul,     // __aeabi_fmul, __mulsf3
+    Fdiv,     // __aeabi_fdiv, __divsf3
+    Fcmpeq,   // __aeabi_fcmpeq
+    Fcmplt,   // __aeabi_fcmplt
+    Fcmple,   // __aeabi_fcmple
+    Fcmpge,   // __aeabi_fcmpge
+    Fcmpgt,   // __aeabi_fcmpgt
+    Fcmpun,   // __aeabi_fcmpun, __unordsf2
+    I2f,      // __aeabi_i2f, __floatsisf
+    Ui2f,     // __aeabi_ui2f, __floatunsisf
+    L2f,      // __aeabi_l2f, __floatdisf
+    Ul2f,     // __aeabi_ul2f, __floatundisf
+    F2iz,     // __aeabi_f2iz, __fixsfsi
+    F2uiz,    // __aeabi_f2uiz, __fixunssfsi
+};
+
+// Issue d'un gestionnaire de swi de l'hôte (VmProperties::m_swiHandlers).
+enum class SwiAction {
+    Continue, // l'exécution reprend à l'instruction suivante, sans sortir de run()
+    Yield,    // run() rend la main sur le numéro du swi, comme sans gestionnaire
+};
+
+// Boucle d'exécution du cache de micro-ops, choisie à l'instanciation de l'ALU.
+enum class Dispatch {
+    SWITCH,   // un appel indirect par instruction depuis une boucle unique
+    THREADED, // chaque handler saute directement au suivant (computed goto GCC/Clang)
 };
 
 enum class AccessPermission {
@@ -80,5 +144,50 @@ class MemoryLayout {
     size_t           size;
     AccessPermission permission;
 };
+
+// Registres d'un périphérique projetés dans l'espace invité (MemoryProtected). Les accès de 1, 2 ou 4 octets
+// contenus dans [start, start + size[ appellent read ou write avec leur décalage depuis start ; un accès sans
+// callback, plus large ou à cheval sur la limite est une faute. Les plages du layout qui le recouvrent sont masquées.
+class MemoryDevice {
+  public:
+    uint32_t                                                               start;
+    size_t                                                                 size;
+    std::function<uint32_t(uint32_t offset, uint32_t size)>                read;
+    std::function<void(uint32_t offset, uint32_t size, uint32_t value)>    write;
+};
+
+// Accès refusé par la mémoire protégée.
+struct MemoryFault {
+    uint32_t         m_address = 0;
+    uint32_t         m_size    = 0;
+    AccessPermission m_access  = AccessPermission::NONE;
+};
+
+// Bilan d'un run() : m_pc désigne la prochaine instruction, ou l'instruction fautive après une faute.
+// Une instruction fautive n'est pas comptée dans m_instructions.
+struct RunResult {
+    Interrupt   m_interrupt    = Interrupt::Undefined;
+    uint64_t    m_instructions = 0;
+    uint32_t    m_pc           = 0;
+    bool        m_faulted      = false;
+    MemoryFault m_fault;
+};
+
+// Bilan de Vm::call(). Quand m_run.m_interrupt vaut Interrupt::Return, la fonction est revenue et m_r0, m_r1 portent
+// sa valeur de retour (m_r1 : moitié haute d'un résultat 64 bits) ; sinon l'appel est suspendu, ou en faute.
+struct CallResult {
+    RunResult m_run;
+    uint32_t  m_r0 = 0;
+    uint32_t  m_r1 = 0;
+
+    uint64_t value() const { return uint64_t{m_r1} << 32 | m_r0; }
+};
+
+// Registres et mots d'état de l'ALU, de quoi reprendre une exécution (Vm::snapshot()).
+struct AluState {
+    std::array<uint32_t, 16> m_registers = {};
+    uint32_t                 m_cpsr      = 0;
+    uint32_t                 m_spsr      = 0;
+};
 } // namespace armv4vm
 
@@ -0,0 +1,128 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "predecode.hpp"
+
+namespace armv4vm {
+
+// Suite d'instructions sans rupture de séquence, terminée par un branchement, une écriture de PC ou un swi.
+// Les micro-ops restent dans le cache de prédécodage : un bloc ne traverse jamais une page de ce cache.
+template <typename Entry>
+struct BasicBlock {
+
+    uint32_t    start;
+    uint32_t    count;
+    Entry      *ops;
+    BasicBlock *links[2];   // successeurs déjà résolus (saut pris, saut non pris)
+    uint32_t    linkPcs[2]; // adresses correspondantes
+
+    // Mode JIT : nombre d'exécutions interprétées, puis code natif des nativeCount premières instructions.
+    // Le code natif renvoie le nombre d'instructions exécutées.
+    uint32_t hits;
+    uint32_t nativeCount;
+    uint32_t (*native)(void *alu, uint32_t *registers);
+
+    BasicBlock *successor(const uint32_t pc) const {
+
+        if (linkPcs[0] == pc) {
+            return links[0];
+        }
+        return linkPcs[1] == pc ? links[1] : nullptr;
+    }
+
+    void link(const uint32_t pc, BasicBlock *block) {
+
+        const int slot = links[0] == nullptr ? 0 : 1;
+
+        links[slot]   = block;
+        linkPcs[slot] = pc;
+    }
+};
+
+// Index des blocs par adresse de départ.
+// Une écriture dans du code traduit retire tous les blocs d'un coup : les liens entre blocs
+// ne peuvent alors plus pointer vers un bloc invalide. Les blocs retirés restent alloués
+// jusqu'à collect(), la boucle d'exécution pouvant encore être dans l'un d'eux.
+template <typename Entry>
+class BlockCache {
+  public:
+    using Block = BasicBlock<Entry>;
+
+    BlockCache() : m_index(nullptr) {}
+
+    void reset(const std::size_t memorySize) {
+
+        clear();
+        m_index.reset(memorySize);
+    }
+
+    void clear() {
+
+        m_index.clear();
+        m_blocks.clear();
+        m_retired.clear();
+        m_generation++;
+    }
+
+    bool empty() const { return m_blocks.empty(); }
+
+    // Change à chaque retrait : un lien établi sous une autre génération n'est plus valide.
+    uint32_t generation() const { return m_generation; }
+
+    Block *find(const uint32_t start) {
+
+        Block **slot = m_index.entry(start);
+        return slot != nullptr ? *slot : nullptr;
+    }
+
+    Block *insert(const uint32_t start, Entry *ops, const uint32_t count) {
+
+        m_blocks.push_back(std::make_unique<Block>(Block{start, count, ops, {nullptr, nullptr}, {0, 0}, 0, 0, nullptr}));
+        *m_index.entry(start) = m_blocks.back().get();
+
+        return m_blocks.back().get();
+    }
+
+    void retire() {
+
+        m_index.clear();
+
+        for (auto &block : m_blocks) {
+            m_retired.push_back(std::move(block));
+        }
+
+        m_blocks.clear();
+        m_generation++;
+    }
+
+    void collect() { m_retired.clear(); }
+
+  private:
+    PredecodeCache<Block *>             m_index;
+    std::vector<std::unique_ptr<Block>> m_blocks;
+    std::vector<std::unique_ptr<Block>> m_retired;
+    uint32_t                            m_generation = 0;
+};
+
+} // namespace armv4vm
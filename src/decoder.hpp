@@ -0,0 +1,221 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace armv4vm {
+
+enum FormatSummary : uint8_t {
+
+    data_processing,
+    multiply,
+    multiply_long,
+    single_data_swap,
+    branch_and_exchange,
+    halfword_data_transfer_register_off,
+    halfword_data_transfer_immediate_off,
+    single_data_transfer,
+    undefined,
+    block_data_transfer,
+    branch,
+    coprocessor_data_transfer,
+    coprocessor_data_operation,
+    coprocessor_register_transfer,
+    software_interrupt,
+    unknown,
+};
+
+namespace decoder {
+
+// § 4.1 - Instruction set summary
+inline constexpr uint32_t DATA_PROCESSING                      = 0x00000000;
+inline constexpr uint32_t MULTIPLY                             = 0x00000090;
+inline constexpr uint32_t MULTIPLY_LONG                        = 0x00800090;
+inline constexpr uint32_t SINGLE_DATA_SWAP                     = 0x01000090;
+inline constexpr uint32_t BRANCH_AND_EXCHANGE                  = 0x012FFF10;
+inline constexpr uint32_t HALFWORD_DATA_TRANSFER_REGISTER_OFF  = 0x00000090;
+inline constexpr uint32_t HALFWORD_DATA_TRANSFER_IMMEDIATE_OFF = 0x00400090;
+inline constexpr uint32_t SINGLE_DATA_TRANSFER                 = 0x04000000;
+inline constexpr uint32_t UNDEFINED                            = 0x06000010;
+inline constexpr uint32_t BLOCK_DATA_TRANSFER                  = 0x08000000;
+inline constexpr uint32_t BRANCH                               = 0x0A000000;
+inline constexpr uint32_t COPROCESSOR_DATA_TRANSFER            = 0x0C000000;
+inline constexpr uint32_t COPROCESSOR_DATA_OPERATION           = 0x0E000000;
+inline constexpr uint32_t COPROCESSOR_REGISTER_TRANSFER        = 0x0E000010;
+inline constexpr uint32_t SOFTWARE_INTERRUPT                   = 0x0F000000;
+
+inline constexpr uint32_t MASK_DATA_PROCESSING                      = 0x0C000000;
+inline constexpr uint32_t MASK_MULTIPLY                             = 0x0FC000F0;
+inline constexpr uint32_t MASK_MULTIPLY_LONG                        = 0x0F8000F0;
+inline constexpr uint32_t MASK_SINGLE_DATA_SWAP                     = 0x0FB00FF0;
+inline constexpr uint32_t MASK_BRANCH_AND_EXCHANGE                  = 0x0FFFFFF0;
+inline constexpr uint32_t MASK_HALFWORD_DATA_TRANSFER_REGISTER_OFF  = 0x0E400F90;
+inline constexpr uint32_t MASK_HALFWORD_DATA_TRANSFER_IMMEDIATE_OFF = 0x0E400090;
+inline constexpr uint32_t MASK_SINGLE_DATA_TRANSFER                 = 0x0C000000;
+inline constexpr uint32_t MASK_UNDEFINED                            = 0x0E000010;
+inline constexpr uint32_t MASK_BLOCK_DATA_TRANSFER                  = 0x0E000000;
+inline constexpr uint32_t MASK_BRANCH                               = 0x0E000000;
+inline constexpr uint32_t MASK_COPROCESSOR_DATA_TRANSFER            = 0x0E000000;
+inline constexpr uint32_t MASK_COPROCESSOR_DATA_OPERATION           = 0x0F000010;
+inline constexpr uint32_t MASK_COPROCESSOR_REGISTER_TRANSFER        = 0x0F000010;
+inline constexpr uint32_t MASK_SOFTWARE_INTERRUPT                   = 0x0F000000;
+
+// Chaîne de masques historique : l'ordre des tests lève les ambiguïtés entre formats.
+constexpr FormatSummary decodeMaskChain(const uint32_t instruction) {
+
+    if ((instruction & MASK_BRANCH_AND_EXCHANGE) == BRANCH_AND_EXCHANGE) {
+        return branch_and_exchange;
+    } else if ((instruction & MASK_SINGLE_DATA_SWAP) == SINGLE_DATA_SWAP) {
+        return single_data_swap;
+    } else if ((instruction & MASK_MULTIPLY) == MULTIPLY) {
+        return multiply;
+    } else if ((instruction & MASK_HALFWORD_DATA_TRANSFER_REGISTER_OFF) == HALFWORD_DATA_TRANSFER_REGISTER_OFF) {
+        return halfword_data_transfer_register_off;
+    } else if ((instruction & MASK_MULTIPLY_LONG) == MULTIPLY_LONG) {
+        return multiply_long;
+    } else if ((instruction & MASK_HALFWORD_DATA_TRANSFER_IMMEDIATE_OFF) == HALFWORD_DATA_TRANSFER_IMMEDIATE_OFF) {
+        return halfword_data_transfer_immediate_off;
+    } else if ((instruction & MASK_COPROCESSOR_DATA_OPERATION) == COPROCESSOR_DATA_OPERATION) {
+        return coprocessor_data_operation;
+    } else if ((instruction & MASK_COPROCESSOR_REGISTER_TRANSFER) == COPROCESSOR_REGISTER_TRANSFER) {
+        return coprocessor_register_transfer;
+    } else if ((instruction & MASK_SOFTWARE_INTERRUPT) == SOFTWARE_INTERRUPT) {
+        return software_interrupt;
+    } else if ((instruction & MASK_UNDEFINED) == UNDEFINED) {
+        return undefined;
+    } else if ((instruction & MASK_BLOCK_DATA_TRANSFER) == BLOCK_DATA_TRANSFER) {
+        return block_data_transfer;
+    } else if ((instruction & MASK_BRANCH) == BRANCH) {
+        return branch;
+    } else if ((instruction & MASK_COPROCESSOR_DATA_TRANSFER) == COPROCESSOR_DATA_TRANSFER) {
+        return coprocessor_data_transfer;
+    } else if ((instruction & MASK_DATA_PROCESSING) == DATA_PROCESSING) {
+        return data_processing;
+    } else if ((instruction & MASK_SINGLE_DATA_TRANSFER) == SINGLE_DATA_TRANSFER) {
+        return single_data_transfer;
+    }
+
+    return unknown;
+}
+
+// Index de la table : bits [27:20] et [7:4] de l'instruction.
+constexpr uint32_t tableIndex(const uint32_t instruction) {
+    return ((instruction >> 16) & 0xFF0) | ((instruction >> 4) & 0x00F);
+}
+
+// Hors de l'index, seuls les bits [19:8] de bx et [11:8] de swp / ldrh / strh interviennent dans la chaîne :
+// ces trois valeurs couvrent tous les cas ("19:8 tous à 1", "11:8 nuls", ni l'un ni l'autre).
+// Une entrée sur laquelle elles ne s'accordent pas vaut unknown et se résout par la chaîne.
+constexpr std::array<FormatSummary, 4096> makeDecodeTable() {
+
+    constexpr std::array<uint32_t, 3> PROBES = {0x000FFF00, 0x00000000, 0x00000100};
+    std::array<FormatSummary, 4096> table    = {};
+
+    for (uint32_t index = 0; index < table.size(); index++) {
+
+        const uint32_t instruction = ((index & 0xFF0) << 16) | ((index & 0x00F) << 4);
+        FormatSummary  format      = decodeMaskChain(instruction | PROBES[0]);
+
+        for (const uint32_t probe : PROBES) {
+
+            if (decodeMaskChain(instruction | probe) != format) {
+                format = unknown;
+            }
+        }
+
+        table[index] = format;
+    }
+
+    return table;
+}
+
+inline constexpr std::array<FormatSummary, 4096> DECODE_TABLE = makeDecodeTable();
+
+constexpr FormatSummary decode(const uint32_t instruction) {
+
+    const FormatSummary format = DECODE_TABLE[tableIndex(instruction)];
+    return format != unknown ? format : decodeMaskChain(instruction);
+}
+
+// Fin de bloc de base : l'instruction peut modifier PC (ou n'est pas exécutable par l'ALU).
+constexpr bool endsBasicBlock(const uint32_t instruction) {
+
+    const bool load    = instruction & 0x00100000;
+    const bool rdIsPc  = ((instruction >> 12) & 0xF) == 15;
+    const bool rnIsPc  = ((instruction >> 16) & 0xF) == 15;
+    const bool indexed = (instruction & 0x01200000) != 0x01000000; // post-indexé ou write-back
+
+    switch (decode(instruction)) {
+
+    case data_processing:
+    case single_data_swap:
+        return rdIsPc;
+
+    case single_data_transfer:
+    case halfword_data_transfer_register_off:
+    case halfword_data_transfer_immediate_off:
+        return (load && rdIsPc) || (indexed && rnIsPc);
+
+    case block_data_transfer:
+        return (load && (instruction & 0x00008000)) || rnIsPc;
+
+    case multiply:
+    case multiply_long:
+    case coprocessor_data_transfer:
+    case coprocessor_data_operation:
+    case coprocessor_register_transfer:
+        return false;
+
+    case branch_and_exchange:
+    case branch:
+    case software_interrupt:
+    case undefined:
+    default:
+        return true;
+    }
+}
+
+// § 4.2 - Bit n de l'entrée cond vrai si la condition passe quand NZCV vaut n.
+constexpr std::array<uint16_t, 16> makeConditionTable() {
+
+    std::array<uint16_t, 16> table = {};
+
+    for (uint32_t nzcv = 0; nzcv < 16; nzcv++) {
+
+        const bool n = nzcv & 0x8;
+        const bool z = nzcv & 0x4;
+        const bool c = nzcv & 0x2;
+        const bool v = nzcv & 0x1;
+
+        const bool passes[16] = {z,  !z,          c,      !c,      n,           !n,          v,    !v,
+                                 c && !z, !c || z, n == v, n != v, !z && n == v, z || n != v, true, false};
+
+        for (uint32_t cond = 0; cond < 16; cond++) {
+            table[cond] = static_cast<uint16_t>(table[cond] | (passes[cond] << nzcv));
+        }
+    }
+
+    return table;
+}
+
+inline constexpr std::array<uint16_t, 16> CONDITION_TABLE = makeConditionTable();
+
+} // namespace decoder
+} // namespace armv4vm
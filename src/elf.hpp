@@ -0,0 +1,188 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "armv4vm_p.hpp"
+
+namespace armv4vm {
+
+// Exécutable ELF32 ARM little-endian (ET_EXEC), tel que le produit l'éditeur de liens avant objcopy : segments
+// PT_LOAD, point d'entrée et table des symboles. Les structures du format sont relues champ par champ, sans <elf.h>.
+class ElfFile {
+  public:
+    using byte = std::byte;
+
+    // Segment PT_LOAD : m_fileSize octets lus à m_offset, complétés de zéros (.bss) jusqu'à m_memorySize.
+    struct Segment {
+        uint32_t         m_address    = 0;
+        uint32_t         m_offset     = 0;
+        uint32_t         m_fileSize   = 0;
+        uint32_t         m_memorySize = 0;
+        AccessPermission m_permission = AccessPermission::NONE;
+    };
+
+    static bool isElf(const std::vector<byte> &content) {
+
+        return content.size() >= 4 && content[0] == byte{0x7F} && content[1] == byte{'E'} && content[2] == byte{'L'} &&
+               content[3] == byte{'F'};
+    }
+
+    // std::nullopt pour un fichier tronqué, d'une autre architecture ou dont un segment sort de l'espace 32 bits.
+    static std::optional<ElfFile> parse(const std::vector<byte> &content) {
+
+        ElfFile elf;
+
+        if (!isElf(content) || content.size() < EHDR_SIZE || content[4] != byte{ELFCLASS32} ||
+            content[5] != byte{ELFDATA2LSB} || read<uint16_t>(content, 16) != ET_EXEC ||
+            read<uint16_t>(content, 18) != EM_ARM) {
+            return std::nullopt;
+        }
+
+        elf.m_entry = read<uint32_t>(content, 24);
+
+        const uint32_t phoff     = read<uint32_t>(content, 28);
+        const uint32_t shoff     = read<uint32_t>(content, 32);
+        const uint16_t phentsize = read<uint16_t>(content, 42);
+        const uint16_t phnum     = read<uint16_t>(content, 44);
+        const uint16_t shentsize = read<uint16_t>(content, 46);
+        const uint16_t shnum     = read<uint16_t>(content, 48);
+
+        if (phnum != 0 && (phentsize < PHDR_SIZE || !contains(content, phoff, uint64_t{phentsize} * phnum))) {
+            return std::nullopt;
+        }
+
+        for (uint32_t i = 0; i < phnum; i++) {
+
+            const std::size_t header = phoff + std::size_t{i} * phentsize;
+
+            if (read<uint32_t>(content, header) != PT_LOAD) {
+                continue;
+            }
+
+            Segment        segment;
+            const uint32_t flags = read<uint32_t>(content, header + 24);
+
+            segment.m_offset     = read<uint32_t>(content, header + 4);
+            segment.m_address    = read<uint32_t>(content, header + 8);
+            segment.m_fileSize   = read<uint32_t>(content, header + 16);
+            segment.m_memorySize = read<uint32_t>(content, header + 20);
+            segment.m_permission = static_cast<AccessPermission>(((flags & (PF_R | PF_X)) ? 0b01 : 0) |
+                                                                 ((flags & PF_W) ? 0b10 : 0));
+
+            if (segment.m_fileSize > segment.m_memorySize ||
+                uint64_t{segment.m_address} + segment.m_memorySize > (uint64_t{1} << 32) ||
+                !contains(content, segment.m_offset, segment.m_fileSize)) {
+                return std::nullopt;
+            }
+
+            elf.m_segments.push_back(segment);
+        }
+
+        // Les symboles ne servent qu'aux outils : une table illisible est ignorée.
+        if (shnum != 0 && shentsize >= SHDR_SIZE && contains(content, shoff, uint64_t{shentsize} * shnum)) {
+
+            for (uint32_t i = 0; i < shnum; i++) {
+
+                const std::size_t section = shoff + std::size_t{i} * shentsize;
+                const uint32_t    link    = read<uint32_t>(content, section + 24);
+
+                if (read<uint32_t>(content, section + 4) == SHT_SYMTAB && link < shnum) {
+                    elf.readSymbols(content, section, shoff + std::size_t{link} * shentsize);
+                }
+            }
+        }
+
+        return elf;
+    }
+
+    uint32_t                        m_entry = 0;
+    std::vector<Segment>            m_segments;
+    std::map<std::string, uint32_t> m_symbols;
+
+  private:
+    static constexpr std::size_t EHDR_SIZE   = 52;
+    static constexpr std::size_t PHDR_SIZE   = 32;
+    static constexpr std::size_t SHDR_SIZE   = 40;
+    static constexpr std::size_t SYM_SIZE    = 16;
+    static constexpr uint8_t     ELFCLASS32  = 1;
+    static constexpr uint8_t     ELFDATA2LSB = 1;
+    static constexpr uint16_t    ET_EXEC     = 2;
+    static constexpr uint16_t    EM_ARM      = 40;
+    static constexpr uint32_t    PT_LOAD     = 1;
+    static constexpr uint32_t    PF_X        = 1;
+    static constexpr uint32_t    PF_W        = 2;
+    static constexpr uint32_t    PF_R        = 4;
+    static constexpr uint32_t    SHT_SYMTAB  = 2;
+    static constexpr uint8_t     STT_SECTION = 3;
+    static constexpr uint8_t     STT_FILE    = 4;
+
+    // Hôte little-endian, comme le reste de la VM.
+    template <typename T>
+    static T read(const std::vector<byte> &content, const std::size_t offset) {
+
+        T value;
+        std::memcpy(&value, content.data() + offset, sizeof(T));
+        return value;
+    }
+
+    static bool contains(const std::vector<byte> &content, const uint64_t offset, const uint64_t size) {
+        return offset <= content.size() && size <= content.size() - offset;
+    }
+
+    // Symboles définis, hors sections, fichiers et symboles de mapping ARM ($a, $d).
+    void readSymbols(const std::vector<byte> &content, const std::size_t symtab, const std::size_t strtab) {
+
+        const uint32_t symbols     = read<uint32_t>(content, symtab + 16);
+        const uint32_t symbolsSize = read<uint32_t>(content, symtab + 20);
+        const uint32_t names       = read<uint32_t>(content, strtab + 16);
+        const uint32_t namesSize   = read<uint32_t>(content, strtab + 20);
+
+        if (!contains(content, symbols, symbolsSize) || !contains(content, names, namesSize)) {
+            return;
+        }
+
+        for (std::size_t symbol = symbols; symbol + SYM_SIZE <= std::size_t{symbols} + symbolsSize; symbol += SYM_SIZE) {
+
+            const uint32_t name  = read<uint32_t>(content, symbol);
+            const uint8_t  type  = read<uint8_t>(content, symbol + 12) & 0xF;
+            const uint16_t index = read<uint16_t>(content, symbol + 14);
+
+            if (name == 0 || name >= namesSize || index == 0 || type == STT_SECTION || type == STT_FILE) {
+                continue;
+            }
+
+            const char       *first = reinterpret_cast<const char *>(content.data() + names + name);
+            const std::string label(first, std::find(first, first + (namesSize - name), '\0'));
+
+            if (!label.empty() && label[0] != '$') {
+                m_symbols.emplace(label, read<uint32_t>(content, symbol + 4));
+            }
+        }
+    }
+};
+
+} // namespace armv4vm
@@ -0,0 +1,502 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// Routines de la bibliothèque C et de libgcc exécutées par l'hôte (HLE) à la place de leur code ARM. Chacune suit
+// l'AAPCS : arguments dans r0-r3, résultat dans r0 (r0 et r1 pour les divisions avec reste et les doubles), retour
+// sur LR. Les registres que l'AAPCS laisse à l'appelé (r1-r3, r12, drapeaux) ne sont pas ceux qu'aurait laissés la
+// routine ARM. La mémoire passe par l'ALU : mêmes permissions et mêmes fautes que pour l'invité.
+//
+// La virgule flottante logicielle calcule avec les float et double de l'hôte, IEEE 754 arrondis au plus près comme
+// libgcc, sous-normaux compris (ni flush-to-zero, ni mode d'arrondi changé par l'hôte). Seuls les NaN diffèrent d'un
+// processeur à l'autre : ils sont reconstruits comme libgcc les rend, bit à bit.
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#include "armv4vm_p.hpp"
+
+namespace armv4vm {
+
+class Hle {
+  public:
+    // Symboles ELF de la routine, dans l'ordre où ils sont cherchés : les alias de libgcc partagent une adresse.
+    static std::span<const char *const> symbols(const HleRoutine routine) {
+
+        static constexpr const char *MEMCPY[]   = {"memcpy"};
+        static constexpr const char *MEMSET[]   = {"memset"};
+        static constexpr const char *STRLEN[]   = {"strlen"};
+        static constexpr const char *IDIV[]     = {"__aeabi_idiv", "__divsi3"};
+        static constexpr const char *UIDIV[]    = {"__aeabi_uidiv", "__udivsi3"};
+        static constexpr const char *IDIVMOD[]  = {"__aeabi_idivmod"};
+        static constexpr const char *UIDIVMOD[] = {"__aeabi_uidivmod"};
+        static constexpr const char *DADD[]     = {"__aeabi_dadd", "__adddf3"};
+        static constexpr const char *DSUB[]     = {"__aeabi_dsub", "__subdf3"};
+        static constexpr const char *DRSUB[]    = {"__aeabi_drsub"};
+        static constexpr const char *DMUL[]     = {"__aeabi_dmul", "__muldf3"};
+        static constexpr const char *DDIV[]     = {"__aeabi_ddiv", "__divdf3"};
+        static constexpr const char *DCMPEQ[]   = {"__aeabi_dcmpeq"};
+        static constexpr const char *DCMPLT[]   = {"__aeabi_dcmplt"};
+        static constexpr const char *DCMPLE[]   = {"__aeabi_dcmple"};
+        static constexpr const char *DCMPGE[]   = {"__aeabi_dcmpge"};
+        static constexpr const char *DCMPGT[]   = {"__aeabi_dcmpgt"};
+        static constexpr const char *DCMPUN[]   = {"__aeabi_dcmpun", "__unorddf2"};
+        static constexpr const char *I2D[]      = {"__aeabi_i2d", "__floatsidf"};
+        static constexpr const char *UI2D[]     = {"__aeabi_ui2d", "__floatunsidf"};
+        static constexpr const char *L2D[]      = {"__aeabi_l2d", "__floatdidf"};
+        static constexpr const char *UL2D[]     = {"__aeabi_ul2d", "__floatundidf"};
+        static constexpr const char *F2D[]      = {"__aeabi_f2d", "__extendsfdf2"};
+        static constexpr const char *D2F[]      = {"__aeabi_d2f", "__truncdfsf2"};
+        static constexpr const char *D2IZ[]     = {"__aeabi_d2iz", "__fixdfsi"};
+        static constexpr const char *D2UIZ[]    = {"__aeabi_d2uiz", "__fixunsdfsi"};
+        static constexpr const char *FADD[]     = {"__aeabi_fadd", "__addsf3"};
+        static constexpr const char *FSUB[]     = {"__aeabi_fsub", "__subsf3"};
+        static constexpr const char *FRSUB[]    = {"__aeabi_frsub"};
+        static constexpr const char *FMUL[]     = {"__aeabi_fmul", "__mulsf3"};
+        static constexpr const char *FDIV[]     = {"__aeabi_fdiv", "__divsf3"};
+        static constexpr const char *FCMPEQ[]   = {"__aeabi_fcmpeq"};
+        static constexpr const char *FCMPLT[]   = {"__aeabi_fcmplt"};
+        static constexpr const char *FCMPLE[]   = {"__aeabi_fcmple"};
+        static constexpr const char *FCMPGE[]   = {"__aeabi_fcmpge"};
+        static constexpr const char *FCMPGT[]   = {"__aeabi_fcmpgt"};
+        static constexpr const char *FCMPUN[]   = {"__aeabi_fcmpun", "__unordsf2"};
+        static constexpr const char *I2F[]      = {"__aeabi_i2f", "__floatsisf"};
+        static constexpr const char *UI2F[]     = {"__aeabi_ui2f", "__floatunsisf"};
+        static constexpr const char *L2F[]      = {"__aeabi_l2f", "__floatdisf"};
+        static constexpr const char *UL2F[]     = {"__aeabi_ul2f", "__floatundisf"};
+        static constexpr const char *F2IZ[]     = {"__aeabi_f2iz", "__fixsfsi"};
+        static constexpr const char *F2UIZ[]    = {"__aeabi_f2uiz", "__fixunssfsi"};
+
+        switch (routine) {
+        case HleRoutine::Memcpy:
+            return MEMCPY;
+        case HleRoutine::Memset:
+            return MEMSET;
+        case HleRoutine::Strlen:
+            return STRLEN;
+        case HleRoutine::Idiv:
+            return IDIV;
+        case HleRoutine::Uidiv:
+            return UIDIV;
+        case HleRoutine::Idivmod:
+            return IDIVMOD;
+        case HleRoutine::Uidivmod:
+            return UIDIVMOD;
+        case HleRoutine::Dadd:
+            return DADD;
+        case HleRoutine::Dsub:
+            return DSUB;
+        case HleRoutine::Drsub:
+            return DRSUB;
+        case HleRoutine::Dmul:
+            return DMUL;
+        case HleRoutine::Ddiv:
+            return DDIV;
+        case HleRoutine::Dcmpeq:
+            return DCMPEQ;
+        case HleRoutine::Dcmplt:
+            return DCMPLT;
+        case HleRoutine::Dcmple:
+            return DCMPLE;
+        case HleRoutine::Dcmpge:
+            return DCMPGE;
+        case HleRoutine::Dcmpgt:
+            return DCMPGT;
+        case HleRoutine::Dcmpun:
+            return DCMPUN;
+        case HleRoutine::I2d:
+            return I2D;
+        case HleRoutine::Ui2d:
+            return UI2D;
+        case HleRoutine::L2d:
+            return L2D;
+        case HleRoutine::Ul2d:
+            return UL2D;
+        case HleRoutine::F2d:
+            return F2D;
+        case HleRoutine::D2f:
+            return D2F;
+        case HleRoutine::D2iz:
+            return D2IZ;
+        case HleRoutine::D2uiz:
+            return D2UIZ;
+        case HleRoutine::Fadd:
+            return FADD;
+        case HleRoutine::Fsub:
+            return FSUB;
+        case HleRoutine::Frsub:
+            return FRSUB;
+        case HleRoutine::Fmul:
+            return FMUL;
+        case HleRoutine::Fdiv:
+            return FDIV;
+        case HleRoutine::Fcmpeq:
+            return FCMPEQ;
+        case HleRoutine::Fcmplt:
+            return FCMPLT;
+        case HleRoutine::Fcmple:
+            return FCMPLE;
+        case HleRoutine::Fcmpge:
+            return FCMPGE;
+        case HleRoutine::Fcmpgt:
+            return FCMPGT;
+        case HleRoutine::Fcmpun:
+            return FCMPUN;
+        case HleRoutine::I2f:
+            return I2F;
+        case HleRoutine::Ui2f:
+            return UI2F;
+        case HleRoutine::L2f:
+            return L2F;
+        case HleRoutine::Ul2f:
+            return UL2F;
+        case HleRoutine::F2iz:
+            return F2IZ;
+        case HleRoutine::F2uiz:
+            return F2UIZ;
+        }
+
+        return {};
+    }
+
+    // Exécute routine sur les registres de alu, PC compris : l'exécution reprend sur LR.
+    template <typename Alu>
+    static void run(const HleRoutine routine, Alu &alu) {
+
+        std::array<uint32_t, 16> &registers = alu.getRegisters();
+
+        switch (routine) {
+        case HleRoutine::Memcpy:
+            memcpy(alu, registers[0], registers[1], registers[2]);
+            break;
+        case HleRoutine::Memset:
+            memset(alu, registers[0], static_cast<uint8_t>(registers[1]), registers[2]);
+            break;
+        case HleRoutine::Strlen:
+            registers[0] = strlen(alu, registers[0]);
+            break;
+        case HleRoutine::Idiv:
+        case HleRoutine::Idivmod:
+            divide(registers);
+            break;
+        case HleRoutine::Uidiv:
+        case HleRoutine::Uidivmod:
+            divideUnsigned(registers);
+            break;
+        default:
+            softFloat(routine, registers);
+            break;
+        }
+
+        registers[15] = registers[14];
+    }
+
+  private:
+    template <typename Float>
+    using Bits = std::conditional_t<sizeof(Float) == sizeof(uint64_t), uint64_t, uint32_t>;
+
+    template <typename Float>
+    static constexpr Bits<Float> SIGN = Bits<Float>{1} << (sizeof(Float) * 8 - 1);
+    template <typename Float>
+    static constexpr Bits<Float> QUIET = Bits<Float>{1} << (std::numeric_limits<Float>::digits - 2);
+
+    static_assert(std::numeric_limits<float>::is_iec559 && std::numeric_limits<double>::is_iec559);
+
+    enum class Operation { Add, Multiply, Divide };
+
+    // Mots entiers quand source et destination sont alignées, octets sinon : même résultat que newlib, chevauchement
+    // compris (copie vers l'avant).
+    template <typename Alu>
+    static void memcpy(Alu &alu, uint32_t destination, uint32_t source, uint32_t size) {
+
+        if (((destination | source) & 3) == 0) {
+
+            for (; size >= 4; size -= 4, destination += 4, source += 4) {
+                alu.template store<uint32_t>(destination, alu.template load<uint32_t>(source));
+            }
+        }
+
+        for (; size != 0; size--) {
+            alu.template store<uint8_t>(destination++, alu.template load<uint8_t>(source++));
+        }
+    }
+
+    template <typename Alu>
+    static void memset(Alu &alu, uint32_t destination, const uint8_t value, uint32_t size) {
+
+        for (; size != 0 && (destination & 3) != 0; size--) {
+            alu.template store<uint8_t>(destination++, value);
+        }
+
+        for (; size >= 4; size -= 4, destination += 4) {
+            alu.template store<uint32_t>(destination, value * 0x01010101u);
+        }
+
+        for (; size != 0; size--) {
+            alu.template store<uint8_t>(destination++, value);
+        }
+    }
+
+    template <typename Alu>
+    static uint32_t strlen(const Alu &alu, const uint32_t string) {
+
+        uint32_t length = 0;
+
+        while (alu.template load<uint8_t>(string + length) != 0) {
+            length++;
+        }
+
+        return length;
+    }
+
+    // __aeabi_idivmod : quotient dans r0, reste dans r1. Division par zéro : la valeur que rend libgcc avec son
+    // __aeabi_idiv0 par défaut (INT_MAX, INT_MIN ou 0 selon le signe du dividende, r1 inchangé), sans l'appeler.
+    static void divide(std::array<uint32_t, 16> &registers) {
+
+        const int32_t numerator   = static_cast<int32_t>(registers[0]);
+        const int32_t denominator = static_cast<int32_t>(registers[1]);
+
+        if (denominator == 0) {
+
+            registers[0] = numerator > 0   ? uint32_t{std::numeric_limits<int32_t>::max()}
+                           : numerator < 0 ? static_cast<uint32_t>(std::numeric_limits<int32_t>::min())
+                                           : 0;
+            return;
+        }
+
+        // INT_MIN / -1 déborde : libgcc rend INT_MIN, reste nul.
+        if (numerator == std::numeric_limits<int32_t>::min() && denominator == -1) {
+
+            registers[1] = 0;
+            return;
+        }
+
+        registers[0] = static_cast<uint32_t>(numerator / denominator);
+        registers[1] = static_cast<uint32_t>(numerator % denominator);
+    }
+
+    // __aeabi_uidivmod. Division par zéro : ~0 pour un dividende non nul, 0 sinon, r1 inchangé.
+    static void divideUnsigned(std::array<uint32_t, 16> &registers) {
+
+        const uint32_t numerator   = registers[0];
+        const uint32_t denominator = registers[1];
+
+        if (denominator == 0) {
+
+            registers[0] = numerator != 0 ? ~0u : 0;
+            return;
+        }
+
+        registers[0] = numerator / denominator;
+        registers[1] = numerator % denominator;
+    }
+
+    // Un double occupe deux registres, mot de poids faible d'abord : r0-r1 pour le premier argument et le résultat,
+    // r2-r3 pour le second. Un float occupe un registre : r0, puis r1.
+    static void softFloat(const HleRoutine routine, std::array<uint32_t, 16> &registers) {
+
+        const uint64_t x  = uint64_t{registers[1]} << 32 | registers[0];
+        const uint64_t y  = uint64_t{registers[3]} << 32 | registers[2];
+        const double   dx = std::bit_cast<double>(x);
+        const double   dy = std::bit_cast<double>(y);
+        const float    fx = std::bit_cast<float>(registers[0]);
+        const float    fy = std::bit_cast<float>(registers[1]);
+
+        const auto setDouble = [&registers](const uint64_t value) {
+            registers[0] = static_cast<uint32_t>(value);
+            registers[1] = static_cast<uint32_t>(value >> 32);
+        };
+
+        switch (routine) {
+        case HleRoutine::Dadd:
+            setDouble(arithmetic<double>(Operation::Add, x, y));
+            break;
+        case HleRoutine::Dsub:
+            setDouble(arithmetic<double>(Operation::Add, x, y ^ SIGN<double>));
+            break;
+        case HleRoutine::Drsub:
+            setDouble(arithmetic<double>(Operation::Add, x ^ SIGN<double>, y));
+            break;
+        case HleRoutine::Dmul:
+            setDouble(arithmetic<double>(Operation::Multiply, x, y));
+            break;
+        case HleRoutine::Ddiv:
+            setDouble(arithmetic<double>(Operation::Divide, x, y));
+            break;
+        case HleRoutine::Dcmpeq:
+            registers[0] = dx == dy;
+            break;
+        case HleRoutine::Dcmplt:
+            registers[0] = dx < dy;
+            break;
+        case HleRoutine::Dcmple:
+            registers[0] = dx <= dy;
+            break;
+        case HleRoutine::Dcmpge:
+            registers[0] = dx >= dy;
+            break;
+        case HleRoutine::Dcmpgt:
+            registers[0] = dx > dy;
+            break;
+        case HleRoutine::Dcmpun:
+            registers[0] = std::isnan(dx) || std::isnan(dy);
+            break;
+        case HleRoutine::I2d:
+            setDouble(std::bit_cast<uint64_t>(static_cast<double>(static_cast<int32_t>(registers[0]))));
+            break;
+        case HleRoutine::Ui2d:
+            setDouble(std::bit_cast<uint64_t>(static_cast<double>(registers[0])));
+            break;
+        case HleRoutine::L2d:
+            setDouble(std::bit_cast<uint64_t>(static_cast<double>(static_cast<int64_t>(x))));
+            break;
+        case HleRoutine::Ul2d:
+            setDouble(std::bit_cast<uint64_t>(static_cast<double>(x)));
+            break;
+        case HleRoutine::F2d:
+            // NaN : charge utile conservée, rendu silencieux.
+            setDouble(std::isnan(fx) ? uint64_t{registers[0] & SIGN<float>} << 32 | 0x7FF8000000000000 |
+                                           uint64_t{registers[0] & 0x007FFFFF} << 29
+                                     : std::bit_cast<uint64_t>(static_cast<double>(fx)));
+            break;
+        case HleRoutine::D2f:
+            // NaN : le NaN positif par défaut, quelle que soit la charge utile.
+            registers[0] = std::isnan(dx) ? 0x7FC00000 : std::bit_cast<uint32_t>(static_cast<float>(dx));
+            break;
+        case HleRoutine::D2iz:
+            registers[0] = toInteger<int32_t>(dx);
+            break;
+        case HleRoutine::D2uiz:
+            registers[0] = toInteger<uint32_t>(dx);
+            break;
+        case HleRoutine::Fadd:
+            registers[0] = arithmetic<float>(Operation::Add, registers[0], registers[1]);
+            break;
+        case HleRoutine::Fsub:
+            registers[0] = arithmetic<float>(Operation::Add, registers[0], registers[1] ^ SIGN<float>);
+            break;
+        case HleRoutine::Frsub:
+            registers[0] = arithmetic<float>(Operation::Add, registers[0] ^ SIGN<float>, registers[1]);
+            break;
+        case HleRoutine::Fmul:
+            registers[0] = arithmetic<float>(Operation::Multiply, registers[0], registers[1]);
+            break;
+        case HleRoutine::Fdiv:
+            registers[0] = arithmetic<float>(Operation::Divide, registers[0], registers[1]);
+            break;
+        case HleRoutine::Fcmpeq:
+            registers[0] = fx == fy;
+            break;
+        case HleRoutine::Fcmplt:
+            registers[0] = fx < fy;
+            break;
+        case HleRoutine::Fcmple:
+            registers[0] = fx <= fy;
+            break;
+        case HleRoutine::Fcmpge:
+            registers[0] = fx >= fy;
+            break;
+        case HleRoutine::Fcmpgt:
+            registers[0] = fx > fy;
+            break;
+        case HleRoutine::Fcmpun:
+            registers[0] = std::isnan(fx) || std::isnan(fy);
+            break;
+        case HleRoutine::I2f:
+            registers[0] = std::bit_cast<uint32_t>(static_cast<float>(static_cast<int32_t>(registers[0])));
+            break;
+        case HleRoutine::Ui2f:
+            registers[0] = std::bit_cast<uint32_t>(static_cast<float>(registers[0]));
+            break;
+        case HleRoutine::L2f:
+            registers[0] = std::bit_cast<uint32_t>(static_cast<float>(static_cast<int64_t>(x)));
+            break;
+        case HleRoutine::Ul2f:
+            registers[0] = std::bit_cast<uint32_t>(static_cast<float>(x));
+            break;
+        case HleRoutine::F2iz:
+            registers[0] = toInteger<int32_t>(fx);
+            break;
+        case HleRoutine::F2uiz:
+            registers[0] = toInteger<uint32_t>(fx);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Résultat correctement arrondi de l'hôte, sauf NaN : libgcc rend l'opérande qui l'a produit avec le bit
+    // silencieux levé, signe et charge utile conservés. Pour l'addition, le premier opérande infini ou NaN ; pour le
+    // produit, le premier NaN, sinon l'infini de 0 * inf ; pour le quotient, le dividende, sauf un diviseur NaN sous un
+    // dividende fini.
+    template <typename Float>
+    static Bits<Float> arithmetic(const Operation operation, const Bits<Float> x, const Bits<Float> y) {
+
+        const Float a      = std::bit_cast<Float>(x);
+        const Float b      = std::bit_cast<Float>(y);
+        const Float result = operation == Operation::Add ? a + b : operation == Operation::Multiply ? a * b : a / b;
+
+        if (!std::isnan(result)) [[likely]] {
+            return std::bit_cast<Bits<Float>>(result);
+        }
+
+        bool first = true;
+
+        switch (operation) {
+        case Operation::Add:
+            first = !std::isfinite(a);
+            break;
+        case Operation::Multiply:
+            first = std::isnan(a) || (!std::isnan(b) && std::isinf(a));
+            break;
+        case Operation::Divide:
+            first = !std::isnan(b) || !std::isfinite(a);
+            break;
+        }
+
+        // Le bit silencieux suffit : l'exposant est déjà plein, sauf pour 0 / 0 où il faut le remplir.
+        return (first ? x : y) | std::bit_cast<Bits<Float>>(std::numeric_limits<Float>::infinity()) | QUIET<Float>;
+    }
+
+    // Troncature vers zéro. libgcc sature hors de l'intervalle, rend 0 pour un NaN et pour tout négatif converti en
+    // non signé.
+    template <typename Integer, typename Float>
+    static uint32_t toInteger(const Float value) {
+
+        static constexpr Float LIMIT = static_cast<Float>(uint64_t{1} << std::numeric_limits<Integer>::digits);
+
+        if (std::isnan(value) || (std::is_unsigned_v<Integer> && std::signbit(value))) {
+            return 0;
+        }
+        if (value >= LIMIT) {
+            return static_cast<uint32_t>(std::numeric_limits<Integer>::max());
+        }
+        if (value < -LIMIT) {
+            return static_cast<uint32_t>(std::numeric_limits<Integer>::min());
+        }
+
+        return static_cast<uint32_t>(static_cast<Integer>(value));
+    }
+};
+
+} // namespace armv4vm
@@ -0,0 +1,360 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// Générateur de code x86-64 du mode JIT : juste les instructions dont la traduction des blocs a besoin.
+// Le code est assemblé dans un vecteur puis recopié dans un tampon mmap qui n'est jamais
+// inscriptible et exécutable en même temps (W^X).
+
+#if defined(__x86_64__) && defined(__linux__)
+#define ARMV4VM_JIT 1
+#else
+#define ARMV4VM_JIT 0
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if ARMV4VM_JIT
+#include <sys/mman.h>
+#endif
+
+namespace armv4vm::jit {
+
+enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Codes de condition x86 (jcc, setcc).
+enum Condition : uint8_t {
+    OVERFLOW     = 0x0,
+    CARRY        = 0x2,
+    NOT_CARRY    = 0x3,
+    ZERO         = 0x4,
+    NOT_ZERO     = 0x5,
+    SIGN         = 0x8,
+};
+
+// Extension de l'opcode 0x81 et opcode de la forme r/m32, r32.
+enum AluOp : uint8_t { ADD = 0, OR = 1, AND = 4, SUB = 5, XOR = 6, CMP = 7 };
+
+// Extension de l'opcode 0xC1.
+enum ShiftOp : uint8_t { ROR = 1, SHL = 4, SHR = 5, SAR = 7 };
+
+class Emitter {
+  public:
+    const std::vector<uint8_t> &code() const { return m_code; }
+    std::size_t                 size() const { return m_code.size(); }
+
+    // mov dst32, src32
+    void mov(const Reg dst, const Reg src) { rm(0x89, src, dst); }
+
+    // mov dst32, imm32
+    void mov(const Reg dst, const uint32_t imm) {
+
+        rex(false, 0, 0, dst);
+        byte(static_cast<uint8_t>(0xB8 + (dst & 7)));
+        dword(imm);
+    }
+
+    // mov dst32, [base + disp]
+    void load(const Reg dst, const Reg base, const int32_t disp) { memory(0x8B, dst, base, disp); }
+
+    // mov [base + disp], src32
+    void store(const Reg base, const int32_t disp, const Reg src) { memory(0x89, src, base, disp); }
+
+    // mov dword [base + disp], imm32
+    void store(const Reg base, const int32_t disp, const uint32_t imm) {
+
+        memory(0xC7, RAX, base, disp);
+        dword(imm);
+    }
+
+    // mov dst32, [base + index] ou movzx dst32, byte [base + index]
+    void loadIndexed(const Reg dst, const Reg base, const Reg index, const bool byteAccess) {
+
+        rex(false, dst, index, base);
+        if (byteAccess) {
+            byte(0x0F);
+            byte(0xB6);
+        } else {
+            byte(0x8B);
+        }
+        sib(dst, base, index);
+    }
+
+    // mov [base + index], src32 ou mov [base + index], src8 (src parmi al, cl, dl, bl)
+    void storeIndexed(const Reg base, const Reg index, const Reg src, const bool byteAccess) {
+
+        rex(false, src, index, base);
+        byte(byteAccess ? 0x88 : 0x89);
+        sib(src, base, index);
+    }
+
+    // mov byte [base + index], imm8
+    void storeIndexed(const Reg base, const Reg index, const uint8_t imm) {
+
+        rex(false, 0, index, base);
+        byte(0xC6);
+        sib(RAX, base, index);
+        byte(imm);
+    }
+
+    // cmp byte [base + index], imm8
+    void cmpIndexed(const Reg base, const Reg index, const uint8_t imm) {
+
+        rex(false, 0, index, base);
+        byte(0x80);
+        sib(static_cast<Reg>(7), base, index);
+        byte(imm);
+    }
+
+    // op dst32, src32
+    void alu(const AluOp op, const Reg dst, const Reg src) { rm(static_cast<uint8_t>((op << 3) | 0x01), src, dst); }
+
+    // op dst32, imm32
+    void alu(const AluOp op, const Reg dst, const uint32_t imm) {
+
+        rex(false, 0, 0, dst);
+        byte(0x81);
+        modrm(3, op, dst);
+        dword(imm);
+    }
+
+    void shift(const ShiftOp op, const Reg dst, const uint8_t amount) {
+
+        rex(false, 0, 0, dst);
+        byte(0xC1);
+        modrm(3, op, dst);
+        byte(amount);
+    }
+
+    // not dst32
+    void bitwiseNot(const Reg dst) {
+
+        rex(false, 0, 0, dst);
+        byte(0xF7);
+        modrm(3, 2, dst);
+    }
+
+    void test(const Reg left, const Reg right) { rm(0x85, right, left); }
+
+    // setcc dst8 puis movzx dst32, dst8 (dst parmi al, cl, dl, bl)
+    void set(const Condition condition, const Reg dst) {
+
+        byte(0x0F);
+        byte(static_cast<uint8_t>(0x90 + condition));
+        modrm(3, 0, dst);
+        byte(0x0F);
+        byte(0xB6);
+        modrm(3, dst, dst);
+    }
+
+    // bt base32, bit32 : CF = bit n° bit de base
+    void bitTest(const Reg base, const Reg bit) {
+
+        rex(false, bit, 0, base);
+        byte(0x0F);
+        byte(0xA3);
+        modrm(3, bit, base);
+    }
+
+    // Sauts en avant : l'offset est écrit par bind().
+    std::size_t jump(const Condition condition) {
+
+        byte(0x0F);
+        byte(static_cast<uint8_t>(0x80 + condition));
+        dword(0);
+        return m_code.size();
+    }
+
+    std::size_t jump() {
+
+        byte(0xE9);
+        dword(0);
+        return m_code.size();
+    }
+
+    void bind(const std::size_t label) { bind(label, m_code.size()); }
+
+    void bind(const std::size_t label, const std::size_t target) {
+
+        const int32_t offset = static_cast<int32_t>(target - label);
+        std::memcpy(&m_code[label - 4], &offset, sizeof(offset));
+    }
+
+    // mov dst64, imm64
+    void mov64(const Reg dst, const uint64_t imm) {
+
+        rex(true, 0, 0, dst);
+        byte(static_cast<uint8_t>(0xB8 + (dst & 7)));
+        for (int i = 0; i < 8; i++) {
+            byte(static_cast<uint8_t>(imm >> (i * 8)));
+        }
+    }
+
+    // mov dst64, src64
+    void mov64(const Reg dst, const Reg src) {
+
+        rex(true, src, 0, dst);
+        byte(0x89);
+        modrm(3, src, dst);
+    }
+
+    void push(const Reg reg) {
+
+        rex(false, 0, 0, reg);
+        byte(static_cast<uint8_t>(0x50 + (reg & 7)));
+    }
+
+    void pop(const Reg reg) {
+
+        rex(false, 0, 0, reg);
+        byte(static_cast<uint8_t>(0x58 + (reg & 7)));
+    }
+
+    // add rsp, imm8 (négatif pour réserver)
+    void adjustStack(const int8_t amount) {
+
+        byte(0x48);
+        byte(0x83);
+        modrm(3, 0, RSP);
+        byte(static_cast<uint8_t>(amount));
+    }
+
+    void call(const Reg target) {
+
+        rex(false, 0, 0, target);
+        byte(0xFF);
+        modrm(3, 2, target);
+    }
+
+    void ret() { byte(0xC3); }
+
+  private:
+    void byte(const uint8_t value) { m_code.push_back(value); }
+
+    void dword(const uint32_t value) {
+
+        for (int i = 0; i < 4; i++) {
+            byte(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void rex(const bool wide, const uint8_t reg, const uint8_t index, const uint8_t base) {
+
+        const uint8_t prefix =
+            static_cast<uint8_t>(0x40 | (wide << 3) | (((reg >> 3) & 1) << 2) | (((index >> 3) & 1) << 1) | ((base >> 3) & 1));
+
+        if (prefix != 0x40) {
+            byte(prefix);
+        }
+    }
+
+    void modrm(const uint8_t mod, const uint8_t reg, const uint8_t rm) {
+        byte(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    // opcode r/m32, r32 entre registres
+    void rm(const uint8_t opcode, const Reg reg, const Reg dst) {
+
+        rex(false, reg, 0, dst);
+        byte(opcode);
+        modrm(3, reg, dst);
+    }
+
+    // [base + disp32] ; base ne peut être ni rsp ni r12 (pas de SIB)
+    void memory(const uint8_t opcode, const Reg reg, const Reg base, const int32_t disp) {
+
+        rex(false, reg, 0, base);
+        byte(opcode);
+        modrm(2, reg, base);
+        dword(static_cast<uint32_t>(disp));
+    }
+
+    // [base + index] ; base ne peut être ni rbp ni r13 (mod 00)
+    void sib(const Reg reg, const Reg base, const Reg index) {
+
+        modrm(0, reg, 4);
+        byte(static_cast<uint8_t>(((index & 7) << 3) | (base & 7)));
+    }
+
+    std::vector<uint8_t> m_code;
+};
+
+#if ARMV4VM_JIT
+
+// Tampon de code natif. Il n'est inscriptible que le temps d'y recopier un bloc.
+class CodeBuffer {
+  public:
+    static constexpr std::size_t CAPACITY = 4 * 1024 * 1024;
+
+    CodeBuffer() {
+
+        void *base = mmap(nullptr, CAPACITY, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        m_base     = base != MAP_FAILED ? static_cast<uint8_t *>(base) : nullptr;
+    }
+
+    ~CodeBuffer() {
+
+        if (m_base != nullptr) {
+            munmap(m_base, CAPACITY);
+        }
+    }
+
+    CodeBuffer(const CodeBuffer &)            = delete;
+    CodeBuffer &operator=(const CodeBuffer &) = delete;
+
+    // nullptr quand le tampon est plein : l'appelant oublie alors tout le code natif (reset()).
+    const void *append(const Emitter &emitter) {
+
+        const std::size_t size = emitter.size();
+
+        if (m_base == nullptr || m_used + size > CAPACITY) {
+            return nullptr;
+        }
+
+        // Seules les pages touchées changent de protection.
+        const std::size_t first = m_used & ~(PAGE - 1);
+        const std::size_t last  = (m_used + size + PAGE - 1) & ~(PAGE - 1);
+
+        if (mprotect(m_base + first, last - first, PROT_READ | PROT_WRITE) != 0) {
+            return nullptr;
+        }
+
+        std::memcpy(m_base + m_used, emitter.code().data(), size);
+        mprotect(m_base + first, last - first, PROT_READ | PROT_EXEC);
+
+        const void *code = m_base + m_used;
+        m_used           = (m_used + size + 15) & ~std::size_t{15};
+
+        return code;
+    }
+
+    void reset() { m_used = 0; }
+
+  private:
+    static constexpr std::size_t PAGE = 4096;
+
+    uint8_t    *m_base = nullptr;
+    std::size_t m_used = 0;
+};
+
+#endif
+
+} // namespace armv4vm::jit
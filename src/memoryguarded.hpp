@@ -0,0 +1,409 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// Mémoire protégée par le MMU de l'hôte : les 4 Gio de l'espace invité sont réservés sans aucun droit, puis chaque
+// plage du layout y est projetée avec ses permissions. Les accès invités coûtent autant qu'avec MemoryRaw ; un accès
+// interdit lève SIGSEGV, que le gestionnaire ramène dans Alu::run() par siglongjmp.
+// Les mêmes pages sont projetées une seconde fois, toujours inscriptibles, pour l'hôte (chargement, UART, etc.).
+
+#if defined(__x86_64__) && defined(__linux__)
+#define ARMV4VM_GUARDED 1
+#else
+#define ARMV4VM_GUARDED 0
+#endif
+
+#include "armv4vm_p.hpp"
+#include "properties.hpp"
+#include "memoryhandler.hpp"
+
+#if ARMV4VM_GUARDED
+#include <csetjmp>
+#include <csignal>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+namespace armv4vm {
+
+#if ARMV4VM_GUARDED
+
+class MemoryGuarded {
+
+  public:
+    friend TestMem;
+    friend TestAluInstruction<MemoryGuarded>;
+    friend TestVfp;
+
+  public:
+    using byte = std::byte;
+
+    // Les fautes ne passent pas par des exceptions : voir Guard.
+    static constexpr bool HOST_FAULTS = true;
+
+    static constexpr std::size_t PAGE = 4096;
+
+    // Espace invité complet, suivi d'une page de garde pour les accès qui débordent de 0xFFFFFFFF.
+    static constexpr std::size_t SPACE = (std::size_t{1} << 32) + PAGE;
+
+    // Le MMU ne protège que des pages entières.
+    static bool isValid(const MemoryProperties &properties) {
+
+        return std::ranges::all_of(properties.m_layout, [](const MemoryLayout &range) {
+            return range.start % PAGE == 0 && range.size % PAGE == 0 && range.start + range.size <= (uint64_t{1} << 32);
+        });
+    }
+
+    // Avec image (Vm::fork()), ses pages non nulles sont recopiées : les deux vues partagent un même fichier, une
+    // projection privée de l'image ne peut donc pas servir ici.
+    MemoryGuarded(struct MemoryProperties &properties, std::shared_ptr<const MemoryImage> image = nullptr) {
+
+        if (!isValid(properties)) {
+            throw std::invalid_argument("MemoryGuarded : plages non alignées sur les pages");
+        }
+
+        installHandler();
+
+        for (const MemoryLayout &range : properties.m_layout) {
+            m_size = std::max<std::size_t>(m_size, range.start + range.size);
+        }
+
+        m_pages.assign(m_size / PAGE, 0);
+        m_image = PageImage(m_size);
+
+        m_file = memfd_create("armv4vm", MFD_CLOEXEC);
+
+        if (m_file < 0 || ftruncate(m_file, static_cast<off_t>(m_size)) != 0) {
+
+            release();
+            throw std::bad_alloc();
+        }
+
+        m_guest = static_cast<byte *>(mmap(nullptr, SPACE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+        m_host  = m_size != 0 ? static_cast<byte *>(mmap(nullptr, m_size, PROT_READ | PROT_WRITE,
+                                                         MAP_SHARED | MAP_NORESERVE, m_file, 0))
+                              : nullptr;
+
+        if (m_guest == MAP_FAILED || m_host == MAP_FAILED) {
+
+            release();
+            throw std::bad_alloc();
+        }
+
+        for (const MemoryLayout &range : properties.m_layout) {
+            addAccessRangeImpl(range);
+        }
+
+        if (image) {
+
+            if (image->size() != m_size) {
+
+                release();
+                throw std::invalid_argument("MemoryGuarded : image de taille différente");
+            }
+
+            for (const uint32_t page : image->pages()) {
+                std::memcpy(m_host + std::size_t{page} * PAGE, image->data() + std::size_t{page} * PAGE, PAGE);
+            }
+            m_image.capture(m_host, std::move(image));
+        }
+    }
+
+    ~MemoryGuarded() { release(); }
+
+    MemoryGuarded(const MemoryGuarded &)            = delete;
+    MemoryGuarded &operator=(const MemoryGuarded &) = delete;
+
+    // Remplir de zéros rend les pages au système : elles reviennent à la demande.
+    byte *reset(const std::byte fillingValue = std::byte{0}) {
+
+        if (fillingValue == std::byte{0}) {
+            fallocate(m_file, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(m_size));
+        } else {
+
+            for (std::size_t page = 0; page < m_pages.size(); page++) {
+
+                if (m_pages[page] != 0) {
+                    std::memset(m_host + page * PAGE, static_cast<int>(fillingValue), PAGE);
+                }
+            }
+        }
+
+        m_image.reset(m_host, fillingValue);
+        return m_host;
+    }
+
+    // Voir MemoryRaw::capture(). Les pages sont restaurées par la vue de l'hôte, quelles que soient leurs permissions.
+    void capture() { m_image.capture(m_host); }
+
+    // Voir MemoryRaw::load(). Recopié : la vue invitée ne peut pas projeter un autre fichier que le sien. Seules les
+    // pages non nulles de l'image sont écrites, le reste de son étendue (.bss, trous) redevient des trous du fichier.
+    void load(std::shared_ptr<const MemoryImage> program) {
+
+        const std::size_t size = std::min(program->size(), m_size);
+        const std::size_t end  = std::min((size + PAGE - 1) & ~(PAGE - 1), m_size);
+
+        fallocate(m_file, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(end));
+
+        for (const uint32_t page : program->pages()) {
+
+            const std::size_t offset = std::size_t{page} * PAGE;
+
+            if (offset < size) {
+                std::memcpy(m_host + offset, program->data() + offset, std::min(PAGE, size - offset));
+            }
+        }
+        m_image.capture(m_host, std::move(program));
+    }
+
+    std::shared_ptr<const MemoryImage> image() const {
+        return std::make_shared<const MemoryImage>(m_host, m_size, m_image.pages());
+    }
+
+    template <typename F>
+    void restore(F &&restored) { m_image.restore(m_host, restored); }
+
+    void markDirty(const uint32_t address, const std::size_t size) { m_image.mark(address, size); }
+
+    PageImage &pageImage() { return m_image; }
+
+    byte *getAddressZero() { return m_host; }
+
+    const byte *getAddressZero() const { return m_host; }
+
+    // Fin de la plus haute plage.
+    std::size_t size() const { return m_size; }
+
+    template <typename T>
+    T readPointer(uint32_t address) const {
+        static_assert(std::is_trivially_copyable_v<T>, "MemoryGuarded::readPointer requires trivially copyable T");
+
+        T value;
+        std::memcpy(&value, m_guest + address, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    MemoryRefUnsafe<T> writePointer(const uint32_t address) {
+
+        m_image.mark(address, sizeof(T));
+        return MemoryRefUnsafe<T>(m_guest, address);
+    }
+
+    template <typename T>
+    MemoryRefUnsafe<T> writePointer(const uint32_t address, const T &value) {
+
+        static_assert(std::is_trivially_copyable_v<T>, "MemoryGuarded::writePointer requires trivially copyable T");
+        m_image.mark(address, sizeof(T));
+        std::memcpy(m_guest + address, &value, sizeof(T));
+        return MemoryRefUnsafe<T>(m_guest, address);
+    }
+
+    MemoryRefUnsafe<std::byte> operator[](std::size_t index) const { return MemoryRefUnsafe<std::byte>(m_guest, index); }
+
+    // Une page couverte par plusieurs plages reçoit l'union de leurs permissions.
+    void addAccessRangeImpl(const MemoryLayout &range) {
+
+        const std::size_t first = range.start / PAGE;
+        const std::size_t last  = std::min((range.start + range.size) / PAGE, m_pages.size());
+
+        for (std::size_t page = first; page < last; page++) {
+            m_pages[page] |= static_cast<uint8_t>(range.permission);
+        }
+
+        protect(first, last);
+    }
+
+    void memcpy(const uint32_t address, const void *source, const size_t size) {
+        m_image.mark(address, size);
+        std::memcpy(m_guest + address, source, size);
+    }
+
+    // Sans faute : la traduction des blocs s'arrête sur un mot illisible au lieu de le lire.
+    bool readable(const uint32_t address) const {
+
+        const std::size_t page = address / PAGE;
+        return page < m_pages.size() && (m_pages[page] & static_cast<uint8_t>(AccessPermission::READ));
+    }
+
+    // Voir MemoryProtected::readOnlyPage().
+    bool readOnlyPage(const uint32_t address) const {
+
+        const std::size_t page = address / PAGE;
+        return page < m_pages.size() && m_pages[page] == static_cast<uint8_t>(AccessPermission::READ);
+    }
+
+    // Accès de l'hôte pour le compte de l'invité (Alu::load/store), hors de toute Guard : la faute passe par
+    // MemoryFaultException, comme avec MemoryProtected, et les destructeurs de l'appelant s'exécutent.
+    void isAccessible(const uint32_t address, const std::size_t dataSize, const AccessPermission permission) const {
+
+        const uint64_t last = uint64_t{address} + dataSize - 1;
+
+        for (uint64_t page = address / PAGE; page <= last / PAGE; page++) {
+
+            if (page >= m_pages.size() || (m_pages[page] & static_cast<uint8_t>(permission)) == 0) [[unlikely]] {
+                throw MemoryFaultException({address, static_cast<uint32_t>(dataSize), permission});
+            }
+        }
+    }
+
+    // Exécution invitée en cours sur ce thread. Le gestionnaire de SIGSEGV y décrit la faute puis revient au
+    // sigsetjmp de context() ; sans Guard actif, la faute est rendue au gestionnaire précédent.
+    class Guard {
+      public:
+        explicit Guard(MemoryGuarded &memory) : m_memory(&memory), m_previous(s_current) { s_current = this; }
+        ~Guard() { s_current = m_previous; }
+
+        Guard(const Guard &)            = delete;
+        Guard &operator=(const Guard &) = delete;
+
+        sigjmp_buf        &context() { return m_context; }
+        const MemoryFault &fault() const { return m_fault; }
+
+      private:
+        friend class MemoryGuarded;
+        friend class Unguard;
+
+        MemoryGuarded *m_memory;
+        Guard         *m_previous;
+        sigjmp_buf     m_context;
+        MemoryFault    m_fault;
+
+        static inline thread_local Guard *s_current = nullptr;
+    };
+
+    // Code de l'hôte appelé pendant l'exécution invitée (gestionnaires de swi, HLE) : un siglongjmp sauterait ses
+    // cadres sans appeler les destructeurs. La Guard est suspendue, une faute y redevient une faute de l'hôte.
+    class Unguard {
+      public:
+        Unguard() : m_suspended(Guard::s_current) { Guard::s_current = nullptr; }
+        ~Unguard() { Guard::s_current = m_suspended; }
+
+        Unguard(const Unguard &)            = delete;
+        Unguard &operator=(const Unguard &) = delete;
+
+      private:
+        Guard *m_suspended;
+    };
+
+  private:
+    // Projette les pages [first, last[ du fichier dans l'espace invité, une projection par suite de pages de mêmes
+    // permissions. Sur x86, une page en écriture seule reste lisible : seul WRITE y est garanti.
+    void protect(std::size_t first, const std::size_t last) {
+
+        while (first < last) {
+
+            std::size_t end = first + 1;
+
+            while (end < last && m_pages[end] == m_pages[first]) {
+                end++;
+            }
+
+            const uint8_t permission = m_pages[first];
+            const int     protection = (permission & static_cast<uint8_t>(AccessPermission::READ) ? PROT_READ : 0) |
+                                   (permission & static_cast<uint8_t>(AccessPermission::WRITE) ? PROT_WRITE : 0);
+
+            mmap(m_guest + first * PAGE, (end - first) * PAGE, protection, MAP_SHARED | MAP_FIXED, m_file,
+                 static_cast<off_t>(first * PAGE));
+
+            first = end;
+        }
+    }
+
+    void release() {
+
+        if (m_guest != nullptr && m_guest != MAP_FAILED) {
+            munmap(m_guest, SPACE);
+        }
+
+        if (m_host != nullptr && m_host != MAP_FAILED) {
+            munmap(m_host, m_size);
+        }
+
+        if (m_file >= 0) {
+            close(m_file);
+        }
+    }
+
+    static void installHandler() {
+
+        static std::once_flag once;
+
+        std::call_once(once, [] {
+
+            // SA_NODEFER : siglongjmp ne restaure pas le masque, SIGSEGV ne doit donc pas rester bloqué.
+            struct sigaction action = {};
+            action.sa_sigaction     = &onFault;
+            action.sa_flags         = SA_SIGINFO | SA_NODEFER | SA_ONSTACK;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGSEGV, &action, &previousAction());
+        });
+    }
+
+    static struct sigaction &previousAction() {
+
+        static struct sigaction previous = {};
+        return previous;
+    }
+
+    static void onFault(const int signal, siginfo_t *info, void *context) {
+
+        Guard      *guard   = Guard::s_current;
+        const byte *address = static_cast<const byte *>(info->si_addr);
+
+        if (guard != nullptr && address >= guard->m_memory->m_guest && address < guard->m_memory->m_guest + SPACE) {
+
+            // Bit 1 du code d'erreur x86 : accès en écriture. La taille de l'accès n'est pas connue.
+            const auto *machine = static_cast<const ucontext_t *>(context);
+            const bool  write   = machine->uc_mcontext.gregs[REG_ERR] & 0x2;
+
+            guard->m_fault = {static_cast<uint32_t>(address - guard->m_memory->m_guest), 0,
+                              write ? AccessPermission::WRITE : AccessPermission::READ};
+            siglongjmp(guard->m_context, 1);
+        }
+
+        // Faute de l'hôte : comportement d'avant l'installation du gestionnaire.
+        const struct sigaction &previous = previousAction();
+
+        if (previous.sa_flags & SA_SIGINFO) {
+            previous.sa_sigaction(signal, info, context);
+        } else if (previous.sa_handler == SIG_DFL || previous.sa_handler == SIG_IGN) {
+
+            // L'instruction fautive s'exécute à nouveau au retour et tue le processus.
+            std::signal(signal, SIG_DFL);
+        } else {
+            previous.sa_handler(signal);
+        }
+    }
+
+    byte                *m_guest = nullptr;
+    byte                *m_host  = nullptr;
+    int                  m_file  = -1;
+    std::size_t          m_size  = 0;
+    std::vector<uint8_t> m_pages;
+    PageImage            m_image;
+};
+
+#endif
+
+} // namespace armv4vm
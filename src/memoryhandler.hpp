@@ -26,10 +26,18 @@
 #include <vector>
 #include <cstring>
 //#include <ranges>
-#include <numeric>
 #include <stdexcept>
 #include <span>
 
+#if defined(__unix__)
+#include <sys/mman.h>
+#endif
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace armv4vm {
 
 class TestMem;
@@ -45,7 +53,20 @@ inline constexpr bool operator&(AccessPermission a, AccessPermission b) {
     return (static_cast<int>(a) & static_cast<int>(b)) != 0;
 }
 
+// Levée par MemoryProtected. run() l'intercepte et la rapporte dans RunResult.
+class MemoryFaultException : public std::runtime_error {
+  public:
+    explicit MemoryFaultException(const MemoryFault &fault) : std::runtime_error("segmentation fault"), m_fault(fault) {}
+
+    const MemoryFault &fault() const noexcept { return m_fault; }
+
+  private:
+    MemoryFault m_fault;
+};
+
 class MemoryProtected;
+template <uint32_t SizeBits>
+class MemoryMasked;
 
 template <typename T>
 class MemoryRefUnsafe {
@@ -77,17 +98,22 @@ class MemoryRefUnsafe {
     }
 
     friend class MemoryRaw;
+    friend class MemoryGuarded;
+    template <uint32_t SizeBits>
+    friend class MemoryMasked;
 
   protected:
     std::byte*  m_base;
     const std::size_t m_address;
 };
 
+// Référence vers la mémoire protégée. Celle que rend writePointer() porte le verdict de son unique contrôle :
+// l'écriture qui suit va droit à la RAM. Celle de operator[], dont on ignore l'usage, contrôle à chaque accès.
 template <typename T>
 class MemoryRefSafe {
   private:
-    MemoryRefSafe(std::byte* base, std::size_t address, MemoryProtected* memoryProtected)
-        : m_base(base), m_address(address), m_memoryProtected(memoryProtected)  {}
+    MemoryRefSafe(std::byte* base, std::size_t address, MemoryProtected* memoryProtected, bool writable = false)
+        : m_base(base), m_address(address), m_memoryProtected(memoryProtected), m_writable(writable) {}
   public:
     operator T() const;
     MemoryRefSafe& operator=(const T& value);
@@ -105,6 +131,7 @@ class MemoryRefSafe {
     std::byte*  m_base;
     std::size_t m_address;
     MemoryProtected* m_memoryProtected;
+    bool             m_writable; // RAM dont l'écriture est déjà accordée (les plages ne font que s'ajouter)
 };
 
 template <typename U>
@@ -117,6 +144,395 @@ bool operator == (const MemoryRefSafe<std::byte> &left, const U right) {
     return *(left.m_base + left.m_address) == std::byte(right);
 }
 
+// Appelle visit(page, longueur) pour chaque page de 4 Kio non nulle parmi pages. Seules ces pages sont lues : une
+// page jamais touchée n'est pas engagée pour rien.
+template <typename F>
+void forEachDataPage(const std::byte *memory, const std::size_t size, const std::vector<uint32_t> &pages, F &&visit) {
+
+    static constexpr std::size_t PAGE = 4096;
+    static const std::byte       zero[PAGE] = {};
+
+    for (const uint32_t page : pages) {
+
+        const std::size_t length = std::min(PAGE, size - page * PAGE);
+
+        if (page * PAGE < size && std::memcmp(memory + page * PAGE, zero, length) != 0) {
+            visit(page, length);
+        }
+    }
+}
+
+// Contenu figé de mémoire invitée (Vm::snapshot(), programme chargé par ProgramCache). Sous Linux, un memfd scellé
+// dont seules les pages non nulles sont écrites : les mémoires qui en partent le projettent en MAP_PRIVATE et ne paient
+// que les pages qu'elles écrivent. Ailleurs, une simple copie. Les pages absentes de pages sont nulles.
+class MemoryImage {
+  public:
+    using byte = std::byte;
+
+    MemoryImage(const byte *memory, const std::size_t size, const std::vector<uint32_t> &pages) : m_size(size) {
+
+#if defined(__linux__)
+        m_file = memfd_create("armv4vm-snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+        if (m_file < 0 || ftruncate(m_file, static_cast<off_t>(size)) != 0) {
+
+            release();
+            throw std::bad_alloc();
+        }
+
+        forEachDataPage(memory, size, pages, [&](const std::size_t page, const std::size_t length) {
+
+            if (pwrite(m_file, memory + page * 4096, length, static_cast<off_t>(page * 4096)) !=
+                static_cast<ssize_t>(length)) {
+
+                release();
+                throw std::bad_alloc();
+            }
+            m_pages.push_back(static_cast<uint32_t>(page));
+        });
+
+        fcntl(m_file, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE);
+
+        void *data = size != 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, m_file, 0) : nullptr;
+
+        if (data == MAP_FAILED) {
+
+            release();
+            throw std::bad_alloc();
+        }
+        m_data = static_cast<const byte *>(data);
+#else
+        m_copy.assign(memory, memory + size);
+        m_data = m_copy.data();
+
+        forEachDataPage(memory, size, pages, [&](const std::size_t page, std::size_t) {
+            m_pages.push_back(static_cast<uint32_t>(page));
+        });
+#endif
+    }
+
+    ~MemoryImage() { release(); }
+
+    MemoryImage(const MemoryImage &)            = delete;
+    MemoryImage &operator=(const MemoryImage &) = delete;
+
+    const byte *data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+    // -1 hors Linux.
+    int file() const { return m_file; }
+
+    // Pages de 4 Kio non nulles, les seules à recopier pour reproduire l'image.
+    const std::vector<uint32_t> &pages() const { return m_pages; }
+
+  private:
+    void release() {
+
+#if defined(__linux__)
+        if (m_data != nullptr) {
+            munmap(const_cast<byte *>(m_data), m_size);
+        }
+
+        if (m_file >= 0) {
+            close(m_file);
+        }
+#endif
+    }
+
+    const byte           *m_data = nullptr;
+    std::size_t           m_size = 0;
+    int                   m_file = -1;
+    std::vector<uint32_t> m_pages;
+    std::vector<byte>     m_copy;
+};
+
+// Stockage de la mémoire invitée, indexé par adresse invitée. Sous POSIX, l'espace est réservé sans être engagé
+// (MAP_NORESERVE) : une page n'occupe de mémoire physique qu'une fois touchée, les trous entre plages ne coûtent
+// rien, et remettre à zéro rend les pages au système au lieu de les écrire.
+class HostMemory {
+  public:
+    using byte = std::byte;
+
+    explicit HostMemory(const std::size_t size) : m_size(size) {
+
+#if defined(__unix__)
+        void *data = size != 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+                               : nullptr;
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        m_data = static_cast<byte *>(data);
+#else
+        m_data = new byte[size]();
+#endif
+    }
+
+    // Copie de image. Sous Linux, projection privée du memfd : les pages sont partagées jusqu'à leur première écriture.
+    explicit HostMemory(const MemoryImage &image) : m_size(image.size()) {
+
+#if defined(__linux__)
+        void *data = m_size != 0 ? mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE,
+                                        image.file(), 0)
+                                 : nullptr;
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        m_data       = static_cast<byte *>(data);
+        m_fileBacked = true;
+#elif defined(__unix__)
+        void *data = m_size != 0 ? mmap(nullptr, m_size, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+                                 : nullptr;
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        m_data = static_cast<byte *>(data);
+        std::memcpy(m_data, image.data(), m_size);
+#else
+        m_data = new byte[m_size];
+        std::memcpy(m_data, image.data(), m_size);
+#endif
+    }
+
+    ~HostMemory() {
+
+#if defined(__unix__)
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+#else
+        delete[] m_data;
+#endif
+    }
+
+    HostMemory(const HostMemory &)            = delete;
+    HostMemory &operator=(const HostMemory &) = delete;
+
+    byte       *data() { return m_data; }
+    const byte *data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+    // Place image à l'adresse 0, reste de sa dernière page à zéro. Sous Linux, projection privée du memfd par-dessus
+    // l'espace : rien n'est recopié avant la première écriture.
+    void map(const MemoryImage &image) {
+
+        static constexpr std::size_t PAGE = 4096;
+
+        const std::size_t size = std::min(image.size(), m_size);
+        const std::size_t end  = std::min((size + PAGE - 1) & ~(PAGE - 1), m_size);
+
+#if defined(__linux__)
+        if (size != 0 && mmap(m_data, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE | MAP_FIXED,
+                              image.file(), 0) != MAP_FAILED) {
+
+            m_fileBacked = true;
+            return;
+        }
+#endif
+        std::memcpy(m_data, image.data(), size);
+        std::memset(m_data + size, 0, end - size);
+    }
+
+    // [start, start + size[ à fillingValue. Les pages entières remises à zéro sont rendues au système.
+    void fill(const std::size_t start, const std::size_t size, const std::byte fillingValue) {
+
+#if defined(__unix__)
+        static constexpr std::size_t PAGE = 4096;
+
+        // MADV_DONTNEED rendrait les pages de l'image et non des zéros : l'espace redevient anonyme. Un échec laisse
+        // l'image en place, la remise à zéro ne peut donc pas continuer.
+        if (m_fileBacked) {
+
+            if (mmap(m_data, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+                     -1, 0) == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            m_fileBacked = false;
+        }
+
+        const std::size_t first = (start + PAGE - 1) & ~(PAGE - 1);
+        const std::size_t last  = (start + size) & ~(PAGE - 1);
+
+        if (fillingValue == std::byte{0} && first < last) {
+
+            std::memset(m_data + start, 0, first - start);
+            madvise(m_data + first, last - first, MADV_DONTNEED);
+            std::memset(m_data + last, 0, start + size - last);
+            return;
+        }
+#endif
+        std::memset(m_data + start, static_cast<int>(fillingValue), size);
+    }
+
+  private:
+    byte       *m_data       = nullptr;
+    std::size_t m_size       = 0;
+    bool        m_fileBacked = false;
+};
+
+// Instantané de la mémoire invitée et pages écrites depuis : restore() ne recopie que ces pages, son coût suit ce que
+// l'invité a touché et non la taille de la mémoire. Seules les pages non nulles de l'instantané sont conservées.
+// Un octet par page de 4 Kio, écrit aussi par le code natif du JIT.
+// Les pages écrites depuis la dernière remise à zéro sont les seules lues pour un instantané : les autres sont nulles.
+class PageImage {
+  public:
+    using byte = std::byte;
+
+    static constexpr uint32_t    PAGE_BITS = 12;
+    static constexpr std::size_t PAGE      = std::size_t{1} << PAGE_BITS;
+
+    explicit PageImage(const std::size_t size = 0)
+        : m_size(size), m_dirty((size + PAGE - 1) >> PAGE_BITS, 0), m_written(m_dirty.size(), 0),
+          m_image(m_dirty.size(), BLANK) {}
+
+    // Les pages du premier au dernier octet écrit. Les écritures hors de l'espace couvert sont ignorées.
+    void mark(const uint32_t address, const std::size_t size) {
+
+        const uint64_t end = std::min<uint64_t>(((uint64_t{address} + size - 1) >> PAGE_BITS) + 1, m_dirty.size());
+
+        for (uint64_t page = address >> PAGE_BITS; size != 0 && page < end; page++) {
+            m_dirty[page] = 1;
+        }
+    }
+
+    // Mémoire entièrement remplie de fillingValue : nouvel état de référence.
+    void reset(const byte *memory, const byte fillingValue) {
+
+        std::fill(m_written.begin(), m_written.end(), fillingValue != byte{0});
+        std::fill(m_dirty.begin(), m_dirty.end(), 0);
+        capture(memory);
+    }
+
+    // Nouvel état de référence. source, quand elle est donnée, vient d'être placée à l'adresse 0 (fork, chargement) :
+    // ses pages ne sont pas recopiées, restore() les reprend dans source.
+    void capture(const byte *memory, std::shared_ptr<const MemoryImage> source = nullptr) {
+
+        m_source = std::move(source);
+        m_shared = m_source ? (std::min(m_source->size(), m_size) + PAGE - 1) >> PAGE_BITS : 0;
+        m_pages.clear();
+        std::fill(m_image.begin(), m_image.end(), BLANK);
+
+        for (std::size_t page = 0; page < m_dirty.size(); page++) {
+
+            m_written[page] |= m_dirty[page];
+            m_dirty[page] = 0;
+        }
+
+        std::vector<uint32_t> written = pages();
+
+        std::erase_if(written, [this](const uint32_t page) { return page < m_shared; });
+
+        forEachDataPage(memory, m_size, written, [&](const std::size_t page, const std::size_t length) {
+
+            m_image[page] = static_cast<uint32_t>(m_pages.size() / PAGE);
+            m_pages.insert(m_pages.end(), memory + page * PAGE, memory + page * PAGE + length);
+            m_pages.resize(m_pages.size() + PAGE - length);
+        });
+
+        if (m_source) {
+
+            for (const uint32_t page : m_source->pages()) {
+
+                if (page < m_shared) {
+                    m_written[page] = 1;
+                }
+            }
+        }
+    }
+
+    // Les pages de [address, address + size[ entrent dans l'état de référence telles qu'elles sont en mémoire, sans
+    // recapturer le reste : retouches de l'hôte après le chargement (routines HLE). Ces pages quittent source().
+    void keep(const byte *memory, const uint32_t address, const std::size_t size) {
+
+        const uint64_t end = std::min<uint64_t>(((uint64_t{address} + size - 1) >> PAGE_BITS) + 1, m_dirty.size());
+
+        for (uint64_t page = address >> PAGE_BITS; size != 0 && page < end; page++) {
+
+            if (m_image[page] == BLANK) {
+
+                m_image[page] = static_cast<uint32_t>(m_pages.size() / PAGE);
+                m_pages.resize(m_pages.size() + PAGE);
+            }
+
+            std::memcpy(m_pages.data() + std::size_t{m_image[page]} * PAGE, memory + page * PAGE, length(page));
+            m_written[page] = 1;
+            m_dirty[page]   = 0;
+        }
+    }
+
+    // Remet les pages écrites dans leur état de l'instantané ; restored reçoit l'adresse de chacune.
+    template <typename F>
+    void restore(byte *memory, F &&restored) {
+
+        for (auto it = std::find(m_dirty.begin(), m_dirty.end(), 1); it != m_dirty.end();
+             it      = std::find(it + 1, m_dirty.end(), 1)) {
+
+            const std::size_t page = static_cast<std::size_t>(it - m_dirty.begin());
+
+            if (m_image[page] != BLANK) {
+                std::memcpy(memory + page * PAGE, m_pages.data() + std::size_t{m_image[page]} * PAGE, length(page));
+            } else if (page < m_shared) {
+
+                const std::size_t shared = std::min(length(page), m_source->size() - page * PAGE);
+
+                std::memcpy(memory + page * PAGE, m_source->data() + page * PAGE, shared);
+                std::memset(memory + page * PAGE + shared, 0, length(page) - shared);
+            } else {
+                std::memset(memory + page * PAGE, 0, length(page));
+            }
+
+            m_written[page] = 1;
+            *it             = 0;
+            restored(static_cast<uint32_t>(page << PAGE_BITS));
+        }
+    }
+
+    // Pages qui peuvent ne pas être nulles : écrites depuis la dernière remise à zéro, ou reprises d'une source.
+    std::vector<uint32_t> pages() const {
+
+        std::vector<uint32_t> result;
+
+        for (std::size_t page = 0; page < m_dirty.size(); page++) {
+
+            if (m_written[page] || m_dirty[page]) {
+                result.push_back(static_cast<uint32_t>(page));
+            }
+        }
+
+        return result;
+    }
+
+    // Image dont la mémoire est partie (load(), fork), nullptr après une remise à zéro.
+    const std::shared_ptr<const MemoryImage> &source() const { return m_source; }
+
+    // Vrai si la page de address a encore le contenu de source() : reprise de l'image et pas écrite depuis.
+    bool pristine(const uint32_t address) const {
+
+        const std::size_t page = address >> PAGE_BITS;
+        return page < m_shared && !m_dirty[page] && m_image[page] == BLANK;
+    }
+
+    // Adresse stable jusqu'à la destruction : le JIT l'inscrit dans le code natif.
+    uint8_t    *dirtyPages() { return m_dirty.data(); }
+    std::size_t pageCount() const { return m_dirty.size(); }
+
+  private:
+    static constexpr uint32_t BLANK = ~0u;
+
+    // La dernière page peut être incomplète.
+    std::size_t length(const std::size_t page) const { return std::min(PAGE, m_size - page * PAGE); }
+
+    std::size_t           m_size;
+    std::vector<uint8_t>  m_dirty;
+    std::vector<uint8_t>  m_written;
+    std::vector<uint32_t> m_image; // rang de la page dans m_pages, BLANK pour une page nulle
+    std::vector<byte>     m_pages;
+
+    // Pages [0, m_shared[ : celles de m_source.
+    std::shared_ptr<const MemoryImage> m_source;
+    std::size_t                        m_shared = 0;
+};
+
 class MemoryRaw  {
 
   public:
@@ -127,24 +543,61 @@ class MemoryRaw  {
   public:
     using byte = std::byte;
 
-    MemoryRaw(struct MemoryProperties & properties) {
-        m_size = properties.m_memorySizeBytes;
-        m_ram  = std::make_unique<byte[]>(m_size);
+    // Les fautes passent par MemoryFaultException (MemoryProtected) ou n'existent pas (MemoryRaw).
+    static constexpr bool HOST_FAULTS = false;
+
+    // Avec image (Vm::fork()), la mémoire part de son contenu au lieu de zéros.
+    MemoryRaw(struct MemoryProperties & properties, std::shared_ptr<const MemoryImage> image = nullptr) {
+        m_size  = properties.m_memorySizeBytes;
+        m_image = PageImage(m_size);
+
+        if (image) {
+
+            if (image->size() != m_size) {
+                throw std::invalid_argument("MemoryRaw : image de taille différente");
+            }
+            m_ram = std::make_unique<HostMemory>(*image);
+            m_image.capture(m_ram->data(), std::move(image));
+        } else {
+            m_ram = std::make_unique<HostMemory>(m_size);
+        }
     }
     ~MemoryRaw() = default;
 
     byte* reset(const std::byte fillingValue = std::byte{0}) {
 
-        std::memset(m_ram.get(), static_cast<char>(fillingValue), m_size);
-        return m_ram.get();
+        m_ram->fill(0, m_size, fillingValue);
+        m_image.reset(m_ram->data(), fillingValue);
+        return m_ram->data();
+    }
+
+    // Voir PageImage. Les écritures de l'hôte par getAddressZero() ou operator[] ne sont pas suivies : markDirty().
+    void capture() { m_image.capture(m_ram->data()); }
+
+    // Programme placé à l'adresse 0, qui devient l'état de référence.
+    void load(std::shared_ptr<const MemoryImage> program) {
+        m_ram->map(*program);
+        m_image.capture(m_ram->data(), std::move(program));
     }
 
+    // Pour Vm::snapshot().
+    std::shared_ptr<const MemoryImage> image() const {
+        return std::make_shared<const MemoryImage>(m_ram->data(), m_size, m_image.pages());
+    }
+
+    template <typename F>
+    void restore(F &&restored) { m_image.restore(m_ram->data(), restored); }
+
+    void markDirty(const uint32_t address, const std::size_t size) { m_image.mark(address, size); }
+
+    PageImage &pageImage() { return m_image; }
+
     byte* getAddressZero() {
-        return m_ram.get();
+        return m_ram->data();
     }
 
     const byte* getAddressZero() const {
-        return m_ram.get();
+        return m_ram->data();
     }
 
     std::size_t size() const {
@@ -157,26 +610,28 @@ class MemoryRaw  {
                       "MemoryRaw::readPointerImpl requires trivially copyable T");
 
         T value;
-        std::memcpy(&value, m_ram.get() + addr, sizeof(T));
+        std::memcpy(&value, m_ram->data() + addr, sizeof(T));
         return value;
     }
 
     template <typename T>
     MemoryRefUnsafe<T> writePointer(const uint32_t address) {
 
-        return MemoryRefUnsafe<T>(m_ram.get(), address);
+        m_image.mark(address, sizeof(T));
+        return MemoryRefUnsafe<T>(m_ram->data(), address);
     }
 
     template <typename T>
     MemoryRefUnsafe<T> writePointer(const uint32_t address, const T& value) {
 
         static_assert(std::is_trivially_copyable_v<T>, "MemoryRaw::writePointerImpl requires trivially copyable T");
-        std::memcpy(m_ram.get() + address, &value, sizeof(T));
-        return MemoryRefUnsafe<T>(m_ram.get(), address);
+        m_image.mark(address, sizeof(T));
+        std::memcpy(m_ram->data() + address, &value, sizeof(T));
+        return MemoryRefUnsafe<T>(m_ram->data(), address);
     }
 
     MemoryRefUnsafe<std::byte> operator[](std::size_t index) const {
-        return MemoryRefUnsafe<std::byte>(m_ram.get(), index);
+        return MemoryRefUnsafe<std::byte>(m_ram->data(), index);
     }
 
     void addAccessRangeImpl(const MemoryLayout& accessRange) {
@@ -184,12 +639,23 @@ class MemoryRaw  {
     }
 
     void memcpy(const uint32_t address, const void * source, const size_t size) {
-        std::memcpy(m_ram.get() + address, source, size);
+        m_image.mark(address, size);
+        std::memcpy(m_ram->data() + address, source, size);
+    }
+
+    bool readable([[maybe_unused]] const uint32_t address) const {
+        return true;
+    }
+
+    // Toute la mémoire s'écrit : aucune page n'est partagée entre VM par l'ALU.
+    bool readOnlyPage([[maybe_unused]] const uint32_t address) const {
+        return false;
     }
 
   private:
-    std::unique_ptr<byte[]> m_ram;
+    std::unique_ptr<HostMemory> m_ram;
     size_t             m_size = 0;
+    PageImage          m_image;
 };
 
 class MemoryProtected {
@@ -202,27 +668,70 @@ class MemoryProtected {
   public:
     using byte = std::byte;
 
-    MemoryProtected(struct MemoryProperties & properties) {
+    static constexpr bool HOST_FAULTS = false;
+
+    // Voir MemoryRaw.
+    MemoryProtected(struct MemoryProperties & properties, std::shared_ptr<const MemoryImage> image = nullptr) {
 
         m_memoryLayout = properties.m_layout;
+        m_devices      = properties.m_devices;
+        m_pageBits     = properties.m_pageBits;
+
+        for (const MemoryLayout &range : m_memoryLayout) {
+            mapPages(range);
+        }
+        mapDevices();
+
+        // Indexée par adresse : l'espace va jusqu'à la fin de la plus haute plage, les trous ne sont jamais touchés.
+        std::size_t end = 0;
+
+        for (const MemoryLayout &range : m_memoryLayout) {
+            end = std::max<std::size_t>(end, range.start + range.size);
+        }
 
-        const size_t totalAllocation = std::accumulate(
-            m_memoryLayout.begin(),
-            m_memoryLayout.end(),
-            0,
-            [](const int &cumul, const MemoryLayout &layout){ return cumul + layout.size; });
+        m_image = PageImage(end);
 
-        m_ram = std::make_unique<std::vector<byte>>(totalAllocation);
-        std::ranges::fill(*m_ram, std::byte{0});
+        if (image) {
+
+            if (image->size() != end) {
+                throw std::invalid_argument("MemoryProtected : image de taille différente");
+            }
+            m_ram = std::make_unique<HostMemory>(*image);
+            m_image.capture(m_ram->data(), std::move(image));
+        } else {
+            m_ram = std::make_unique<HostMemory>(end);
+        }
     }
     ~MemoryProtected() = default;
 
     byte *reset(const std::byte fillingValue = std::byte{0}) {
 
-        std::ranges::fill(*m_ram, fillingValue);
+        for (const MemoryLayout &range : m_memoryLayout) {
+            m_ram->fill(range.start, std::min(range.size, m_ram->size() - range.start), fillingValue);
+        }
+        m_image.reset(m_ram->data(), fillingValue);
         return m_ram->data();
     }
 
+    // Voir MemoryRaw::capture().
+    void capture() { m_image.capture(m_ram->data()); }
+
+    void load(std::shared_ptr<const MemoryImage> program) {
+        m_ram->map(*program);
+        m_image.capture(m_ram->data(), std::move(program));
+    }
+
+    std::shared_ptr<const MemoryImage> image() const {
+        return std::make_shared<const MemoryImage>(m_ram->data(), m_ram->size(), m_image.pages());
+    }
+
+    template <typename F>
+    void restore(F &&restored) { m_image.restore(m_ram->data(), restored); }
+
+    void markDirty(const uint32_t address, const std::size_t size) { m_image.mark(address, size); }
+
+    PageImage &pageImage() { return m_image; }
+
     byte* getAddressZero() {
         return m_ram ? m_ram->data() : nullptr;
     }
@@ -235,12 +744,16 @@ class MemoryProtected {
         return m_ram ? m_ram->size() : 0;
     }
 
+    // Les pages de périphérique n'ont aucune permission dans la table : leurs accès quittent le chemin rapide au
+    // même test qu'une faute, la RAM n'en paie rien.
     template <typename T>
     T readPointer(uint32_t address) const {
         static_assert(std::is_trivially_copyable_v<T>,
                       "MemoryProtected::readPointerImpl requires trivially copyable T");
 
-        isAccessible(address, sizeof(T), AccessPermission::READ);
+        if (!allowed(address, sizeof(T), AccessPermission::READ)) [[unlikely]] {
+            return readSlow<T>(address);
+        }
 
         T value;
         std::memcpy(&value, m_ram->data() + address, sizeof(T));
@@ -250,72 +763,274 @@ class MemoryProtected {
     template <typename T>
     MemoryRefSafe<T> writePointer(const uint32_t address, const T& value) {
         static_assert(std::is_trivially_copyable_v<T>, "MemoryProtected::writePointerImpl requires trivially copyable T");
-        isAccessible(address, sizeof(T), AccessPermission::WRITE);
-        std::memcpy(m_ram.get()->data() + address, &value, sizeof(T));
-        return MemoryRefSafe<T>(m_ram.get()->data(), address, this);
+
+        if (!allowed(address, sizeof(T), AccessPermission::WRITE)) [[unlikely]] {
+
+            writeSlow<T>(address, value);
+            return MemoryRefSafe<T>(m_ram->data(), address, this);
+        }
+
+        m_image.mark(address, sizeof(T));
+        std::memcpy(m_ram->data() + address, &value, sizeof(T));
+        return MemoryRefSafe<T>(m_ram->data(), address, this, true);
     }
 
+    // Un seul contrôle par écriture : la référence rendue le garde, son operator= ne le refait pas.
     template <typename T>
     MemoryRefSafe<T> writePointer(const uint32_t address) {
         static_assert(std::is_trivially_copyable_v<T>);
-        isAccessible(address, sizeof(T), AccessPermission::WRITE);
-        return MemoryRefSafe<T>(m_ram.get()->data(), address, this);
+
+        if (!allowed(address, sizeof(T), AccessPermission::WRITE)) [[unlikely]] {
+
+            if (!checkSlow(address, sizeof(T), AccessPermission::WRITE)) {
+                return MemoryRefSafe<T>(m_ram->data(), address, this);
+            }
+        }
+
+        m_image.mark(address, sizeof(T));
+        return MemoryRefSafe<T>(m_ram->data(), address, this, true);
     }
 
     MemoryRefSafe<std::byte> operator[](const std::size_t index) {
 
         // On ne peut pas faire de controle d'accés.
         // On n'en connait pas encore l'utilisation. read ? write ?
-        return MemoryRefSafe<std::byte>(m_ram.get()->data(), index, this);
+        return MemoryRefSafe<std::byte>(m_ram->data(), index, this);
     }
 
-    void addAccessRangeImpl(const MemoryLayout& accessRange) {
+    // L'espace est fixé à la construction : une plage ajoutée ensuite y est tronquée.
+    void addAccessRangeImpl(MemoryLayout accessRange) {
+        const std::size_t end = m_ram->size();
+        accessRange.size = accessRange.start < end ? std::min(accessRange.size, end - accessRange.start) : 0;
         m_memoryLayout.push_back(accessRange);
+        mapPages(accessRange);
+        mapDevices();
     }
 
     void memcpy(const uint32_t address, const void * source, const size_t size) {
         isAccessible(address, size, AccessPermission::WRITE);
-        std::memcpy(m_ram.get()->data() + address, source, size);
+        m_image.mark(address, size);
+        std::memcpy(m_ram->data() + address, source, size);
+    }
+
+    bool readable(const uint32_t address) const {
+        return allowed(address, sizeof(uint32_t), AccessPermission::READ);
+    }
+
+    // Vrai si chaque mot de la page de 4 Kio de address se lit sans pouvoir s'écrire : l'ALU peut alors en partager
+    // le décodage avec les autres VM parties de la même image.
+    bool readOnlyPage(const uint32_t address) const {
+
+        const uint32_t first = address & ~uint32_t{0xFFF};
+
+        for (uint64_t word = first; word < uint64_t{first} + 0x1000; word += 4) {
+
+            if (!allowed(static_cast<uint32_t>(word), 4, AccessPermission::READ) ||
+                allowed(static_cast<uint32_t>(word), 4, AccessPermission::WRITE)) {
+                return false;
+            }
+        }
+
+        return true;
     }
 
     void isAccessible(uint32_t address,
                       std::size_t dataSize,
                       const AccessPermission& permission) const
     {
+        if (!allowed(address, dataSize, permission)) [[unlikely]] {
+            throw MemoryFaultException({address, static_cast<uint32_t>(dataSize), permission});
+        }
+    }
+
+    // Un accès contenu dans une page se règle par une seule lecture de la table.
+    // Seules les pages qu'une plage ne couvre qu'en partie renvoient au parcours des plages.
+    bool allowed(const uint32_t address, const std::size_t dataSize, const AccessPermission permission) const {
+
+        const std::size_t page = address >> m_pageBits;
+
+        if (dataSize != 0 && page == ((address + dataSize - 1) >> m_pageBits) && page < m_pages.size()) [[likely]] {
+
+            const uint8_t entry = m_pages[page];
+
+            if (entry & static_cast<uint8_t>(permission)) {
+                return true;
+            }
+
+            if (!(entry & PAGE_PARTIAL)) {
+                return false;
+            }
+        }
+
+        return scan(address, dataSize, permission);
+    }
+
+    // Référence : l'accès doit tenir entièrement dans une plage qui accorde la permission, sans toucher un
+    // périphérique.
+    bool scan(const uint32_t address, const std::size_t dataSize, const AccessPermission permission) const {
+
         auto test = [&](const MemoryLayout& range) {
             return  (range.permission & permission) &&
                    (address >= range.start) &&
                    ((address + dataSize) <= (range.start + range.size));
         };
 
-        const bool allowed = std::any_of(m_memoryLayout.begin(), m_memoryLayout.end(), test);
+        auto touches = [&](const MemoryDevice &device) {
+            return uint64_t{address} + dataSize > device.start && address < uint64_t{device.start} + device.size;
+        };
+
+        return std::any_of(m_memoryLayout.begin(), m_memoryLayout.end(), test) &&
+               std::none_of(m_devices.begin(), m_devices.end(), touches);
+    }
+
+    // Périphérique qui contient entièrement un accès de 1, 2 ou 4 octets, nullptr sinon.
+    const MemoryDevice *device(const uint32_t address, const std::size_t dataSize) const {
+
+        for (const MemoryDevice &device : m_devices) {
+
+            if (dataSize <= sizeof(uint32_t) && address >= device.start &&
+                uint64_t{address} + dataSize <= uint64_t{device.start} + device.size) {
+                return &device;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Accès refusés par la table : registre de périphérique, morceau de page couvert par une plage, sinon faute.
+    template <typename T>
+    T readSlow(const uint32_t address) const {
+
+        T value;
+
+        if (const MemoryDevice *target = device(address, sizeof(T)); target != nullptr && target->read) {
+
+            const uint32_t data = target->read(address - target->start, sizeof(T));
+            std::memcpy(&value, &data, sizeof(T));
+        } else if (target == nullptr && scan(address, sizeof(T), AccessPermission::READ)) {
+            std::memcpy(&value, m_ram->data() + address, sizeof(T));
+        } else {
+            throw MemoryFaultException({address, static_cast<uint32_t>(sizeof(T)), AccessPermission::READ});
+        }
+
+        return value;
+    }
+
+    template <typename T>
+    void writeSlow(const uint32_t address, const T &value) {
+
+        if (const MemoryDevice *target = device(address, sizeof(T)); target != nullptr && target->write) {
+
+            uint32_t data = 0;
+            std::memcpy(&data, &value, sizeof(T));
+            target->write(address - target->start, sizeof(T), data);
+        } else if (target == nullptr && scan(address, sizeof(T), AccessPermission::WRITE)) {
+
+            m_image.mark(address, sizeof(T));
+            std::memcpy(m_ram->data() + address, &value, sizeof(T));
+        } else {
+            throw MemoryFaultException({address, static_cast<uint32_t>(sizeof(T)), AccessPermission::WRITE});
+        }
+    }
+
+    // writePointer() sans valeur : vrai pour de la RAM, faux pour un registre de périphérique, dont l'écriture suivra
+    // par MemoryRefSafe et writeSlow().
+    bool checkSlow(const uint32_t address, const std::size_t dataSize, const AccessPermission permission) const {
+
+        const MemoryDevice *target = device(address, dataSize);
 
-        if (!allowed) {
-            throw std::runtime_error("segmentation fault");
+        if (target != nullptr ? !(permission == AccessPermission::READ ? bool(target->read) : bool(target->write))
+                              : !scan(address, dataSize, permission)) {
+            throw MemoryFaultException({address, static_cast<uint32_t>(dataSize), permission});
         }
+
+        return target == nullptr;
     }
 
   public:
     template<typename T> friend class MemoryRefSafe;
 
   private:
-    std::unique_ptr<std::vector<byte>> m_ram;
+    // Entrée de la table : READ et WRITE des plages couvrant toute la page, PAGE_PARTIAL si une plage n'en couvre
+    // qu'une partie.
+    static constexpr uint8_t PAGE_PARTIAL = 0b0100;
+
+    // Page touchée par un périphérique : ni READ, ni WRITE, ni PAGE_PARTIAL, tout accès part sur le chemin lent.
+    static constexpr uint8_t PAGE_DEVICE = 0b1000;
+
+    void mapDevices() {
+
+        for (const MemoryDevice &device : m_devices) {
+
+            if (device.size == 0) {
+                continue;
+            }
+
+            const std::size_t first = device.start >> m_pageBits;
+            const std::size_t last  = static_cast<std::size_t>((uint64_t{device.start} + device.size - 1) >> m_pageBits);
+
+            if (m_pages.size() <= last) {
+                m_pages.resize(last + 1, 0);
+            }
+
+            std::fill(m_pages.begin() + first, m_pages.begin() + last + 1, PAGE_DEVICE);
+        }
+    }
+
+    void mapPages(const MemoryLayout &range) {
+
+        if (range.size == 0) {
+            return;
+        }
+
+        const uint64_t    pageSize = uint64_t{1} << m_pageBits;
+        const uint64_t    start    = range.start;
+        const uint64_t    end      = start + range.size;
+        const std::size_t last     = static_cast<std::size_t>((end - 1) >> m_pageBits);
+
+        if (m_pages.size() <= last) {
+            m_pages.resize(last + 1, 0);
+        }
+
+        for (uint64_t page = (start + pageSize - 1) >> m_pageBits; page < end >> m_pageBits; page++) {
+            m_pages[page] |= static_cast<uint8_t>(range.permission);
+        }
+
+        if (start & (pageSize - 1)) {
+            m_pages[start >> m_pageBits] |= PAGE_PARTIAL;
+        }
+
+        if (end & (pageSize - 1)) {
+            m_pages[last] |= PAGE_PARTIAL;
+        }
+    }
+
+    std::unique_ptr<HostMemory>        m_ram;
     std::vector<MemoryLayout>           m_memoryLayout;
+    std::vector<MemoryDevice>           m_devices;
+    std::vector<uint8_t>                m_pages;
+    uint32_t                            m_pageBits;
+    PageImage                           m_image;
     struct MemoryProperties m_properties;
 };
 
 template <typename T>
 MemoryRefSafe<T>::operator T() const {
     static_assert(std::is_trivially_copyable_v<T>);
-    m_memoryProtected->isAccessible(m_address, sizeof(T), AccessPermission::READ);
-    T value;
-    std::memcpy(&value, m_base + m_address, sizeof(T));
-    return value;
+    return m_memoryProtected->template readPointer<T>(static_cast<uint32_t>(m_address));
 }
 template <typename T>
 MemoryRefSafe<T>& MemoryRefSafe<T>::operator=(const T& value) {
     static_assert(std::is_trivially_copyable_v<T>);
-    m_memoryProtected->isAccessible(m_address, sizeof(T), AccessPermission::WRITE);
+
+    const uint32_t address = static_cast<uint32_t>(m_address);
+
+    if (!m_writable && !m_memoryProtected->allowed(address, sizeof(T), AccessPermission::WRITE)) [[unlikely]] {
+
+        m_memoryProtected->writeSlow(address, value);
+        return *this;
+    }
+
     std::memcpy(m_base + m_address, &value, sizeof(T));
     return *this;
 }
@@ -323,10 +1038,7 @@ MemoryRefSafe<T>& MemoryRefSafe<T>::operator=(const T& value) {
        // Attention, ça ne clone pas.
 template <typename T>
 MemoryRefSafe<T>& MemoryRefSafe<T>::operator = (const MemoryRefSafe<T> &other) {
-    m_memoryProtected->isAccessible(other.m_address, sizeof(T), AccessPermission::READ);
-    m_memoryProtected->isAccessible(m_address, sizeof(T), AccessPermission::WRITE);
-    std::memcpy(m_base + m_address, other.m_base + other.m_address, sizeof(T));
-    return *this;
+    return *this = static_cast<T>(other);
 }
 
 inline bool operator == (const std::byte &left, const int &right) {
@@ -0,0 +1,170 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// Mémoire de 2^SizeBits octets dont chaque adresse invitée est masquée (address & (SIZE - 1)) : aucun test, aucune
+// faute, mais aucun accès de l'invité ne sort de l'allocation. Un accès de plusieurs octets qui part de la fin de
+// l'espace déborde dans une queue de garde, relue comme des zéros après reset() ou restore(), au lieu de revenir à
+// l'adresse 0. Aussi rapide que MemoryRaw, sûre pour l'hôte ; l'invité n'y est pas protégé de lui-même.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "armv4vm_p.hpp"
+#include "properties.hpp"
+#include "memoryhandler.hpp"
+
+namespace armv4vm {
+
+template <uint32_t SizeBits>
+class MemoryMasked {
+
+  public:
+    friend TestMem;
+    friend TestAluInstruction<MemoryMasked<SizeBits>>;
+    friend TestVfp;
+
+  public:
+    using byte = std::byte;
+
+    static_assert(SizeBits >= 12 && SizeBits <= 32, "MemoryMasked : de 4 Kio à 4 Gio");
+
+    static constexpr bool        HOST_FAULTS  = false;
+    static constexpr std::size_t SIZE         = std::size_t{1} << SizeBits;
+    static constexpr uint32_t    ADDRESS_MASK = static_cast<uint32_t>(SIZE - 1);
+    static constexpr std::size_t GUARD        = sizeof(uint64_t); // plus large accès d'une instruction
+
+    // m_memorySizeBytes est ignoré : la taille est celle du type. Voir MemoryRaw pour image.
+    MemoryMasked([[maybe_unused]] struct MemoryProperties &properties, std::shared_ptr<const MemoryImage> image = nullptr)
+        : m_ram(std::make_unique<HostMemory>(SIZE + GUARD)), m_image(SIZE) {
+
+        if (image) {
+
+            if (image->size() != SIZE) {
+                throw std::invalid_argument("MemoryMasked : image de taille différente");
+            }
+            m_ram->map(*image);
+            m_image.capture(m_ram->data(), std::move(image));
+        }
+    }
+    ~MemoryMasked() = default;
+
+    byte *reset(const std::byte fillingValue = std::byte{0}) {
+
+        m_ram->fill(0, SIZE, fillingValue);
+        std::memset(m_ram->data() + SIZE, 0, GUARD);
+        m_image.reset(m_ram->data(), fillingValue);
+        return m_ram->data();
+    }
+
+    void capture() { m_image.capture(m_ram->data()); }
+
+    void load(std::shared_ptr<const MemoryImage> program) {
+        m_ram->map(*program);
+        m_image.capture(m_ram->data(), std::move(program));
+    }
+
+    std::shared_ptr<const MemoryImage> image() const {
+        return std::make_shared<const MemoryImage>(m_ram->data(), SIZE, m_image.pages());
+    }
+
+    template <typename F>
+    void restore(F &&restored) {
+        m_image.restore(m_ram->data(), restored);
+        std::memset(m_ram->data() + SIZE, 0, GUARD);
+    }
+
+    void markDirty(const uint32_t address, const std::size_t size) { m_image.mark(address & ADDRESS_MASK, size); }
+
+    PageImage &pageImage() { return m_image; }
+
+    byte *getAddressZero() {
+        return m_ram->data();
+    }
+
+    const byte *getAddressZero() const {
+        return m_ram->data();
+    }
+
+    std::size_t size() const {
+        return SIZE;
+    }
+
+    template <typename T>
+    T readPointer(const uint32_t address) const {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= GUARD,
+                      "MemoryMasked::readPointer requires trivially copyable T");
+
+        T value;
+        std::memcpy(&value, m_ram->data() + (address & ADDRESS_MASK), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    MemoryRefUnsafe<T> writePointer(const uint32_t address) {
+        static_assert(sizeof(T) <= GUARD);
+
+        m_image.mark(address & ADDRESS_MASK, sizeof(T));
+        return MemoryRefUnsafe<T>(m_ram->data(), address & ADDRESS_MASK);
+    }
+
+    template <typename T>
+    MemoryRefUnsafe<T> writePointer(const uint32_t address, const T &value) {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= GUARD,
+                      "MemoryMasked::writePointer requires trivially copyable T");
+
+        m_image.mark(address & ADDRESS_MASK, sizeof(T));
+        std::memcpy(m_ram->data() + (address & ADDRESS_MASK), &value, sizeof(T));
+        return MemoryRefUnsafe<T>(m_ram->data(), address & ADDRESS_MASK);
+    }
+
+    MemoryRefUnsafe<std::byte> operator[](const std::size_t index) const {
+        return MemoryRefUnsafe<std::byte>(m_ram->data(), index & ADDRESS_MASK);
+    }
+
+    void addAccessRangeImpl(const MemoryLayout &accessRange) {
+        (void)accessRange;
+    }
+
+    // Copie de l'hôte : elle doit tenir dans l'espace, aucun masque ne la replierait.
+    void memcpy(const uint32_t address, const void *source, const size_t size) {
+
+        if (uint64_t{address} + size > SIZE) {
+            throw std::out_of_range("MemoryMasked : copie hors de l'espace");
+        }
+        m_image.mark(address, size);
+        std::memcpy(m_ram->data() + address, source, size);
+    }
+
+    bool readable([[maybe_unused]] const uint32_t address) const {
+        return true;
+    }
+
+    bool readOnlyPage([[maybe_unused]] const uint32_t address) const {
+        return false;
+    }
+
+  private:
+    std::unique_ptr<HostMemory> m_ram;
+    PageImage                   m_image;
+};
+
+} // namespace armv4vm
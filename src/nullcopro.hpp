@@ -47,11 +47,11 @@ class NullCopro final : public CoprocessorBase<NullCopro<MemoryHandler>> {
     void coprocessorRegisterTransfersImpl(const uint32_t workingInstruction);
 
     void attach(MemoryHandler *mem) { m_mem = mem; }
-    void attach(Alu<MemoryHandler, NullCopro> *alu) { m_alu = alu; }
+    void attach(AluBase *alu) { m_alu = alu; }
 
   private:
     MemoryHandler *m_mem;
-    Alu<MemoryHandler, NullCopro>  *m_alu;
+    AluBase       *m_alu;
     friend class TestVm;
 };
 
@@ -0,0 +1,254 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace armv4vm {
+
+// Tableau des instructions décodées, à côté de la mémoire, indexé par adresse invitée / 4. Une page n'est allouée
+// qu'à la première exécution de son code : le coût suit la taille du code, pas celle de la mémoire invitée. Une entrée
+// vierge est celle passée au constructeur ; l'ALU y met un handler qui décode l'instruction à sa première exécution.
+// Une page peut aussi être empruntée, décodée en entier, à un PredecodeShare : elle n'est jamais écrite, et une
+// invalidation donne d'abord au cache sa propre copie.
+template <typename Entry>
+class PredecodeCache {
+  public:
+    static constexpr uint32_t PAGE_BITS    = 12;
+    static constexpr uint32_t PAGE_ENTRIES = (1u << PAGE_BITS) / sizeof(uint32_t);
+
+    using Page = std::array<Entry, PAGE_ENTRIES>;
+
+    // Page de l'exécution en cours (voir entry(address, cursor)).
+    struct Cursor {
+        Entry   *page       = nullptr;
+        uint32_t base       = 0;
+        uint32_t generation = 0;
+    };
+
+    // Page décodée d'avance pour cet index, nullptr si elle doit rester privée.
+    using Lender = std::function<std::shared_ptr<Page>(uint32_t index)>;
+
+    explicit PredecodeCache(const Entry &blank) : m_blank(blank) {}
+
+    // Couvre l'espace [0, memorySize[ et oublie tout ce qui a été décodé, prêteur compris.
+    void reset(const std::size_t memorySize) {
+
+        m_pages.clear();
+        m_pages.resize((memorySize + (1u << PAGE_BITS) - 1) >> PAGE_BITS);
+        m_present.assign(m_pages.size(), 0);
+        m_borrowed.assign(m_pages.size(), 0);
+        m_lender = nullptr;
+        m_generation++;
+    }
+
+    // Consulté à la première utilisation de chaque page, jusqu'au prochain reset().
+    void lend(Lender lender) { m_lender = std::move(lender); }
+
+    void clear() {
+
+        for (auto &page : m_pages) {
+            page.reset();
+        }
+
+        std::fill(m_present.begin(), m_present.end(), 0);
+        std::fill(m_borrowed.begin(), m_borrowed.end(), 0);
+        m_generation++;
+    }
+
+    // nullptr quand l'adresse sort de l'espace couvert.
+    Entry *entry(const uint32_t address) {
+
+        const uint32_t index = address >> PAGE_BITS;
+
+        if (index >= m_pages.size()) {
+            return nullptr;
+        }
+
+        if (!m_pages[index]) {
+
+            if (m_lender) {
+                m_pages[index] = m_lender(index);
+            }
+
+            m_borrowed[index] = m_pages[index] != nullptr;
+
+            if (!m_pages[index]) {
+
+                // Sans mise à zéro préalable : fill() écrit déjà chaque entrée.
+                m_pages[index] = std::make_shared_for_overwrite<Page>();
+                m_pages[index]->fill(m_blank);
+            }
+            m_present[index] = 1;
+        }
+
+        return &(*m_pages[index])[(address >> 2) & (PAGE_ENTRIES - 1)];
+    }
+
+    // Comme entry(address), sans consulter la table tant que l'adresse reste dans la page du curseur et qu'aucune
+    // page n'a été libérée ou remplacée depuis : la boucle d'exécution ne revient à la table qu'en changeant de page.
+    Entry *entry(const uint32_t address, Cursor &cursor) {
+
+        const uint32_t offset = address - cursor.base;
+
+        if (offset < (1u << PAGE_BITS) && cursor.generation == m_generation) [[likely]] {
+            return cursor.page + (offset >> 2);
+        }
+
+        Entry *found = entry(address);
+
+        if (found != nullptr) {
+            cursor = {found - ((address >> 2) & (PAGE_ENTRIES - 1)), address & ~((1u << PAGE_BITS) - 1), m_generation};
+        }
+
+        return found;
+    }
+
+    // Vrai si du code a déjà été décodé dans la page de cette adresse.
+    bool isCode(const uint32_t address) const {
+
+        const uint32_t index = address >> PAGE_BITS;
+        return index < m_pages.size() && m_pages[index];
+    }
+
+    // Vrai si la page de cette adresse est celle d'un PredecodeShare.
+    bool isShared(const uint32_t address) const {
+
+        const uint32_t index = address >> PAGE_BITS;
+        return index < m_borrowed.size() && m_borrowed[index];
+    }
+
+    // Un octet non nul par page allouée : lu directement par le code natif du JIT.
+    // Le tableau ne bouge pas entre deux reset().
+    const uint8_t *presentPages() const { return m_present.data(); }
+    std::size_t    pageCount() const { return m_pages.size(); }
+
+    // Appelé après une écriture en mémoire invitée : les mots touchés seront décodés à nouveau.
+    // Vrai si l'un d'eux avait déjà été décodé.
+    bool invalidate(const uint32_t address, const std::size_t size) {
+
+        const uint32_t first   = address & ~3u;
+        const uint32_t count   = ((address & 3u) + static_cast<uint32_t>(size) + 3) >> 2;
+        bool           decoded = false;
+
+        for (uint32_t i = 0; i < count; i++) {
+
+            const uint32_t word = first + i * 4;
+
+            if (isCode(word)) {
+
+                const uint32_t index = word >> PAGE_BITS;
+
+                if (m_borrowed[index]) {
+
+                    m_pages[index]    = std::make_shared<Page>(*m_pages[index]);
+                    m_borrowed[index] = 0;
+                    m_generation++;
+                }
+
+                Entry &entry = (*m_pages[index])[(word >> 2) & (PAGE_ENTRIES - 1)];
+
+                decoded |= !(entry == m_blank);
+                entry = m_blank;
+            }
+        }
+
+        return decoded;
+    }
+
+  private:
+    Entry                              m_blank;
+    std::vector<std::shared_ptr<Page>> m_pages;
+    std::vector<uint8_t>               m_present;
+    std::vector<uint8_t>               m_borrowed;
+    Lender                             m_lender;
+    // Change dès qu'une page peut avoir été libérée ou remplacée : les curseurs antérieurs sont périmés.
+    uint32_t                           m_generation = 1;
+};
+
+// Pages décodées d'une même image mémoire (programme chargé, instantané), communes aux caches de toutes les VM qui
+// en partent : le code exécuté par des centaines de VM n'est décodé et stocké qu'une fois. Une page est décodée en
+// entier à sa création, sous verrou, puis ne change plus ; les caches peuvent donc la lire depuis n'importe quel
+// thread. Une instance par type d'entrée, donc par type d'ALU.
+template <typename Entry>
+class PredecodeShare {
+  public:
+    using Page = typename PredecodeCache<Entry>::Page;
+
+    PredecodeShare(std::shared_ptr<const void> image, const std::size_t size)
+        : m_image(std::move(image)), m_pages((size + (1u << PredecodeCache<Entry>::PAGE_BITS) - 1) >>
+                                             PredecodeCache<Entry>::PAGE_BITS) {}
+
+    // Celle de image, créée au premier appel ; elle vit tant qu'un cache s'en sert et retient l'image jusque-là.
+    static std::shared_ptr<PredecodeShare> of(const std::shared_ptr<const void> &image, const std::size_t size) {
+
+        static std::mutex                                                mutex;
+        static std::map<const void *, std::weak_ptr<PredecodeShare>> shares;
+
+        const std::lock_guard<std::mutex> lock(mutex);
+
+        std::erase_if(shares, [](const auto &share) { return share.second.expired(); });
+
+        std::weak_ptr<PredecodeShare>  &slot  = shares[image.get()];
+        std::shared_ptr<PredecodeShare> share = slot.lock();
+
+        if (!share) {
+
+            share = std::make_shared<PredecodeShare>(image, size);
+            slot  = share;
+        }
+
+        return share;
+    }
+
+    // decode(page) remplit les entrées de la page index lors de son premier emprunt. nullptr hors de l'image.
+    template <typename F>
+    std::shared_ptr<Page> page(const uint32_t index, F &&decode) {
+
+        if (index >= m_pages.size()) {
+            return nullptr;
+        }
+
+        const std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_pages[index]) {
+
+            std::shared_ptr<Page> page = std::make_shared<Page>();
+
+            decode(*page);
+            m_pages[index] = std::move(page);
+        }
+
+        return m_pages[index];
+    }
+
+  private:
+    std::shared_ptr<const void>        m_image;
+    std::mutex                         m_mutex;
+    std::vector<std::shared_ptr<Page>> m_pages;
+};
+
+} // namespace armv4vm
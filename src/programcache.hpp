@@ -0,0 +1,205 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "elf.hpp"
+#include "memoryhandler.hpp"
+
+namespace armv4vm {
+
+// Programme invité prêt à être placé en mémoire. Un fichier binaire brut (objcopy -O binary) est un unique segment
+// à l'adresse 0, exécuté depuis l'adresse 0 ; un exécutable ELF place chacun de ses segments à son adresse, et son
+// .bss n'est fait que de pages absentes de l'image, nulles sans être recopiées.
+struct Program {
+    std::shared_ptr<const MemoryImage> m_image; // de l'adresse 0 à la fin du plus haut segment, .bss compris
+    uint32_t                           m_entry = 0;
+    std::vector<ElfFile::Segment>      m_segments;
+    std::map<std::string, uint32_t>    m_symbols; // vide pour un binaire brut
+
+    std::optional<uint32_t> symbol(const std::string &name) const {
+
+        const auto it = m_symbols.find(name);
+        return it != m_symbols.end() ? std::optional<uint32_t>(it->second) : std::nullopt;
+    }
+
+    // Plages de MemoryProperties::m_layout déduites des segments, étendues aux pages de 4 Kio (MemoryGuarded) ;
+    // les segments qui partagent une page en cumulent les permissions. La pile et les échanges restent à ajouter.
+    std::vector<MemoryLayout> layout() const {
+
+        static constexpr uint64_t PAGE = 4096;
+
+        std::vector<ElfFile::Segment> segments = m_segments;
+        std::vector<MemoryLayout>     result;
+
+        std::ranges::sort(segments, {}, &ElfFile::Segment::m_address);
+
+        for (const ElfFile::Segment &segment : segments) {
+
+            if (segment.m_memorySize == 0) {
+                continue;
+            }
+
+            const uint64_t start = segment.m_address & ~(PAGE - 1);
+            const uint64_t end   = (uint64_t{segment.m_address} + segment.m_memorySize + PAGE - 1) & ~(PAGE - 1);
+
+            if (!result.empty() && start < result.back().start + result.back().size) {
+
+                MemoryLayout &last = result.back();
+
+                last.size       = std::max<uint64_t>(last.start + last.size, end) - last.start;
+                last.permission = static_cast<AccessPermission>(static_cast<int>(last.permission) |
+                                                                static_cast<int>(segment.m_permission));
+            } else {
+                result.push_back({static_cast<uint32_t>(start), static_cast<std::size_t>(end - start), segment.m_permission});
+            }
+        }
+
+        return result;
+    }
+};
+
+// Programmes invités, partagés par toutes les VM du processus : un fichier n'est lu qu'une fois tant que son chemin,
+// sa taille et sa date de modification ne changent pas. Chaque VM projette ensuite l'image en privé
+// (MemoryHandler::load()), sans la recopier.
+class ProgramCache {
+  public:
+    // nullptr quand le fichier ne peut pas être lu.
+    static std::shared_ptr<const Program> load(const std::string &path) {
+
+        std::error_code error;
+        const auto      size     = std::filesystem::file_size(path, error);
+        const auto      modified = error ? std::filesystem::file_time_type() : std::filesystem::last_write_time(path, error);
+
+        if (error) {
+            return nullptr;
+        }
+
+        const std::lock_guard<std::mutex> lock(mutex());
+        Entry                            &entry = entries()[path];
+
+        if (entry.m_program && entry.m_size == size && entry.m_modified == modified) {
+            return entry.m_program;
+        }
+
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        std::vector<std::byte> content(size);
+
+        if (!file.read(reinterpret_cast<char *>(content.data()), static_cast<std::streamsize>(size))) {
+
+            entries().erase(path);
+            return nullptr;
+        }
+
+        std::shared_ptr<Program> program = std::make_shared<Program>();
+
+        if (ElfFile::isElf(content)) {
+
+            std::optional<ElfFile> elf = ElfFile::parse(content);
+
+            if (!elf) {
+
+                entries().erase(path);
+                return nullptr;
+            }
+
+            program->m_entry    = elf->m_entry;
+            program->m_segments = std::move(elf->m_segments);
+            program->m_symbols  = std::move(elf->m_symbols);
+        } else {
+            program->m_segments.push_back({0, 0, static_cast<uint32_t>(size), static_cast<uint32_t>(size),
+                                           AccessPermission::READ_WRITE});
+        }
+
+        program->m_image = place(content, program->m_segments);
+        entry            = {size, modified, program};
+        return entry.m_program;
+    }
+
+    // Oublie toutes les images ; celles encore utilisées vivent jusqu'à la fin de leurs VM.
+    static void clear() {
+
+        const std::lock_guard<std::mutex> lock(mutex());
+        entries().clear();
+    }
+
+  private:
+    struct Entry {
+        uintmax_t                       m_size = 0;
+        std::filesystem::file_time_type m_modified;
+        std::shared_ptr<const Program>  m_program;
+    };
+
+    // Segments placés à leur adresse dans un espace réservé sans être engagé : seules les pages qui reçoivent des
+    // octets du fichier sont écrites, puis retenues dans l'image.
+    static std::shared_ptr<const MemoryImage> place(const std::vector<std::byte>       &content,
+                                                    const std::vector<ElfFile::Segment> &segments) {
+
+        std::size_t           end = 0;
+        std::vector<uint32_t> pages;
+
+        for (const ElfFile::Segment &segment : segments) {
+            end = std::max<std::size_t>(end, std::size_t{segment.m_address} + segment.m_memorySize);
+        }
+
+        HostMemory memory(end);
+
+        for (const ElfFile::Segment &segment : segments) {
+
+            if (segment.m_fileSize == 0) {
+                continue;
+            }
+
+            std::memcpy(memory.data() + segment.m_address, content.data() + segment.m_offset, segment.m_fileSize);
+
+            for (uint32_t page = segment.m_address >> 12; page <= (segment.m_address + segment.m_fileSize - 1) >> 12;
+                 page++) {
+                pages.push_back(page);
+            }
+        }
+
+        std::ranges::sort(pages);
+        pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+        return std::make_shared<const MemoryImage>(memory.data(), end, pages);
+    }
+
+    static std::mutex &mutex() {
+
+        static std::mutex instance;
+        return instance;
+    }
+
+    static std::map<std::string, Entry> &entries() {
+
+        static std::map<std::string, Entry> instance;
+        return instance;
+    }
+};
+
+} // namespace armv4vm
@@ -3,15 +3,31 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <optional>
+#include <functional>
+#include <map>
 
 #include "armv4vm_p.hpp"
 
 namespace armv4vm {
 
 class MemoryProtected;
+class Vm;
 
 struct AluProperties {
 
+    enum ExecutionMode {
+        INTERPRETER, // fetch, decode, evaluate à chaque instruction
+        PREDECODED,  // chaque mot est décodé une seule fois dans un cache indexé par PC/4
+        THREADED,    // cache PREDECODED, enchaînement des handlers par computed goto (Alu<..., Dispatch::THREADED>)
+        BLOCK,       // blocs de base chaînés entre eux, budget d'instructions vérifié par bloc
+        JIT,         // BLOCK, puis code x86-64 pour les blocs chauds (MemoryRaw sur Linux x86-64, sinon BLOCK)
+    };
+
+    ExecutionMode m_executionMode;
+    uint32_t      m_jitThreshold; // exécutions interprétées d'un bloc avant sa compilation
+
+    AluProperties() : m_executionMode(ExecutionMode::INTERPRETER), m_jitThreshold(50) {}
 };
 
 struct MemoryProperties {
@@ -20,18 +36,24 @@ struct MemoryProperties {
         UNDEFINED, // peut-être à dégager..
         RAW,
         PROTECTED,
+        GUARDED,   // permissions du layout appliquées par le MMU de l'hôte (MemoryGuarded, Linux x86-64)
+        MASKED,    // adresses masquées sur une puissance de deux, sans permissions (MemoryMasked)
     };
 
     Type                        m_type;
     std::size_t m_memorySizeBytes;
     std::vector<armv4vm::MemoryLayout> m_layout;
+    std::vector<armv4vm::MemoryDevice> m_devices; // MemoryProtected uniquement
+    uint32_t m_pageBits; // granularité de la table des permissions de MemoryProtected (12 : pages de 4 Kio)
 
-    MemoryProperties() : m_type(Type::UNDEFINED), m_memorySizeBytes(0) { m_layout.clear(); }
+    MemoryProperties() : m_type(Type::UNDEFINED), m_memorySizeBytes(0), m_pageBits(12) { m_layout.clear(); }
     MemoryProperties(const MemoryProperties &other) {
 
         m_type = other.m_type;
         m_memorySizeBytes = other.m_memorySizeBytes;
         m_layout = other.m_layout;
+        m_devices = other.m_devices;
+        m_pageBits = other.m_pageBits;
     }
 
     MemoryProperties operator=(const MemoryProperties &other) {
@@ -39,6 +61,8 @@ struct MemoryProperties {
         m_type = other.m_type;
         m_memorySizeBytes = other.m_memorySizeBytes;
         m_layout = other.m_layout;
+        m_devices = other.m_devices;
+        m_pageBits = other.m_pageBits;
         return *this;
     }
 };
@@ -47,6 +71,12 @@ struct CoproProperties {
 
 };
 
+// Routine de l'invité exécutée par l'hôte : à m_address, ou à l'adresse de son symbole quand le programme est un ELF.
+struct HleHook {
+    HleRoutine              m_routine;
+    std::optional<uint32_t> m_address;
+};
+
 struct VmProperties {
 
     VmProperties() {
@@ -59,20 +89,42 @@ struct VmProperties {
 
         m_bin = other.m_bin;
         m_debug = other.m_debug;
+        m_trampoline = other.m_trampoline;
+        m_swiHandlers = other.m_swiHandlers;
+        m_hle = other.m_hle;
+        m_aluProperties = other.m_aluProperties;
         m_memoryProperties = other.m_memoryProperties;
+        m_coproProperties = other.m_coproProperties;
     }
 
     VmProperties operator=(const VmProperties &other) {
 
         m_bin      = other.m_bin;
         m_debug    = other.m_debug;
+        m_trampoline = other.m_trampoline;
+        m_swiHandlers = other.m_swiHandlers;
+        m_hle = other.m_hle;
+        m_aluProperties = other.m_aluProperties;
         m_memoryProperties = other.m_memoryProperties;
+        m_coproProperties = other.m_coproProperties;
 
         return *this;
     }
 
     bool m_debug;
     std::string m_bin;
+    // Mot où Vm::call() place son trampoline de retour, dans une plage lisible et inscriptible hors périphérique
+    // (sinon Vm::build échoue). Par défaut le dernier mot de la mémoire ou, avec un layout, le plus haut mot qui
+    // convient.
+    std::optional<uint32_t> m_trampoline;
+    // Gestionnaires de swi par numéro (moins de 256), appelés dans run() avec la VM qui l'exécute : registres par
+    // Vm::registers(), mémoire par getAddressZero(). Un numéro sans gestionnaire sort de run() comme avant.
+    // Avec MemoryProperties::GUARDED, le SIGSEGV n'est pas rattrapé pendant le gestionnaire : une page interdite y est
+    // une faute de l'hôte.
+    std::map<uint32_t, std::function<SwiAction(Vm &)>> m_swiHandlers;
+    // Routines remplacées au chargement : leur première instruction devient swi Interrupt::Hle, l'hôte fait le
+    // travail puis revient sur LR. Une routine sans adresse dont le programme n'a pas le symbole est ignorée.
+    std::vector<HleHook> m_hle;
     AluProperties m_aluProperties;
     MemoryProperties m_memoryProperties;
     CoproProperties m_coproProperties;
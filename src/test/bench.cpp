@@ -0,0 +1,336 @@
+//    Copyright (c) 2020-26, thierry vic
+//
+//    This file is part of armv4vm.
+//
+//    armv4vm is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    armv4vm is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with armv4vm.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compare les modes d'exécution sur les programmes de test_compile.
+// usage : bench [répétitions]
+// Seule la boucle run() est chronométrée ; chaque série donne son meilleur temps et sa médiane, la médiane ramenée
+// au nombre d'instructions exécutées par le programme. Deux modes ne se comparent que sur leurs médianes.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "armv4vm.hpp"
+
+using namespace armv4vm;
+
+namespace {
+
+struct Mode {
+    const char                  *name;
+    AluProperties::ExecutionMode mode;
+    MemoryProperties::Type       memory; // PROTECTED, GUARDED : layout de armv4vm.ld ; MASKED : 32 Mio
+};
+
+const Mode MODES[] = {
+    {"interpreter", AluProperties::INTERPRETER, MemoryProperties::RAW},
+    {"predecoded", AluProperties::PREDECODED, MemoryProperties::RAW},
+    {"threaded", AluProperties::THREADED, MemoryProperties::RAW},
+    {"block", AluProperties::BLOCK, MemoryProperties::RAW},
+    {"jit", AluProperties::JIT, MemoryProperties::RAW},
+    {"interp+prot", AluProperties::INTERPRETER, MemoryProperties::PROTECTED},
+    {"thread+prot", AluProperties::THREADED, MemoryProperties::PROTECTED},
+    {"interp+mask", AluProperties::INTERPRETER, MemoryProperties::MASKED},
+    {"thread+mask", AluProperties::THREADED, MemoryProperties::MASKED},
+#if ARMV4VM_GUARDED
+    {"interp+guard", AluProperties::INTERPRETER, MemoryProperties::GUARDED},
+    {"thread+guard", AluProperties::THREADED, MemoryProperties::GUARDED},
+#endif
+};
+
+const char *PROGRAMS[] = {"bench.bin", "primen.bin", "hello.bin", "printf.bin"};
+
+// Instructions exécutées par le programme, d'après le bilan de chaque run().
+uint64_t countInstructions(const std::string &program) {
+
+    VmProperties vmProperties;
+    vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+    vmProperties.m_bin                                = program;
+
+    std::unique_ptr<Vm> vm    = Vm::build(vmProperties);
+    uint64_t            count = 0;
+
+    vm->reset();
+
+    if (!vm->load()) {
+        return 0;
+    }
+
+    for (RunResult result; result.m_interrupt != Interrupt::Stop && !result.m_faulted;) {
+
+        result = vm->run(0, std::nothrow);
+        count += result.m_instructions;
+    }
+
+    return count;
+}
+
+VmProperties configure(const std::string &program, const Mode &mode) {
+
+    VmProperties vmProperties;
+    vmProperties.m_aluProperties.m_executionMode      = mode.mode;
+    vmProperties.m_bin                                = program;
+
+    if (mode.memory == MemoryProperties::PROTECTED || mode.memory == MemoryProperties::GUARDED) {
+
+        // rom (code, data, bss), ram, stack, uart
+        vmProperties.m_memoryProperties.m_layout = {{0x00000000, 4_mb, AccessPermission::READ_WRITE},
+                                                    {0x00400000, 8_mb, AccessPermission::READ_WRITE},
+                                                    {0x00C00000, 4_mb, AccessPermission::READ_WRITE},
+                                                    {0x01000000, 1_mb, AccessPermission::READ_WRITE}};
+        vmProperties.m_memoryProperties.m_type   = mode.memory;
+    } else {
+        vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+        vmProperties.m_memoryProperties.m_type            = mode.memory;
+    }
+
+    return vmProperties;
+}
+
+// Durée d'une exécution complète en millisecondes, sortie UART comprise.
+double measure(const std::string &program, const Mode &mode, std::string &output) {
+
+    std::unique_ptr<Vm> vm   = Vm::build(configure(program, mode));
+    std::byte          *uart = vm->reset() + 0x01000000;
+    bool                running = true;
+
+    if (!vm->load()) {
+        return -1.0;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    while (running) {
+
+        switch (vm->run()) {
+
+        case Interrupt::Stop:
+            running = false;
+            break;
+
+        case Interrupt::Suspend:
+            output += static_cast<char>(*uart);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Remise à l'état d'après load() d'une VM qui vient d'exécuter le programme : reset() et load(), puis restore() ;
+// création d'une VM dans cet état par Vm::fork(). Durées en microsecondes, meilleure de la série.
+void measureReset(const std::string &program, const int repetitions, double &reload, double &restore, double &fork) {
+
+    VmProperties vmProperties;
+    vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+    vmProperties.m_bin                                = program;
+
+    std::unique_ptr<Vm> vm = Vm::build(vmProperties);
+
+    vm->reset();
+    vm->load();
+
+    const std::shared_ptr<const VmSnapshot> snapshot = vm->snapshot();
+
+    for (int i = 0; i < repetitions; i++) {
+
+        while (vm->run() != Interrupt::Stop) {
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        vm->reset();
+        vm->load();
+        double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        reload         = i == 0 || elapsed < reload ? elapsed : reload;
+
+        while (vm->run() != Interrupt::Stop) {
+        }
+
+        start   = std::chrono::steady_clock::now();
+        vm->restore();
+        elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        restore = i == 0 || elapsed < restore ? elapsed : restore;
+
+        start                      = std::chrono::steady_clock::now();
+        std::unique_ptr<Vm> forked = Vm::fork(snapshot);
+        elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        fork    = i == 0 || elapsed < fork ? elapsed : fork;
+    }
+}
+
+// Durée moyenne d'un Vm::call() en nanosecondes, sur une fonction de deux instructions (add r0, r0, r1 ; mov pc, lr)
+// placée dans la RAM de armv4vm.ld.
+double measureCall(const Mode &mode, const int calls) {
+
+    static constexpr uint32_t FUNCTION = 0x00400000;
+
+    std::unique_ptr<Vm> vm  = Vm::build(configure("", mode));
+    std::byte          *mem = vm->reset();
+    const uint32_t      code[] = {0xe0800001, 0xe1a0f00e};
+
+    std::memcpy(mem + FUNCTION, code, sizeof(code));
+    vm->markDirty(FUNCTION, sizeof(code));
+
+    uint32_t sum = 0;
+
+    for (int i = 0; i < 100; i++) {
+        sum += vm->call(FUNCTION, i, 1).m_r0;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < calls; i++) {
+        sum += vm->call(FUNCTION, i, 1).m_r0;
+    }
+
+    const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    return sum != 0 ? elapsed / calls : -1.0;
+}
+
+// Durée moyenne en nanosecondes de __aeabi_uidivmod et d'un memset de 256 octets de hello.bin, appelés par Vm::call()
+// après l'exécution du programme : code ARM de libgcc et newlib (arm), puis routines de l'hôte (host).
+void measureHle(const std::string &program, const Mode &mode, const int calls, double (&arm)[4], double (&host)[4]) {
+
+    static constexpr uint32_t UIDIVMOD = 0x28040;
+    static constexpr uint32_t MEMSET   = 0x9070;
+    static constexpr uint32_t DMUL     = 0x285d0;
+    static constexpr uint32_t DDIV     = 0x28860;
+    static constexpr uint32_t BUFFER   = 0x00500000;
+
+    for (const bool hooked : {false, true}) {
+
+        VmProperties vmProperties = configure(program, mode);
+
+        if (hooked) {
+            vmProperties.m_hle = {{HleRoutine::Uidivmod, UIDIVMOD},
+                                  {HleRoutine::Memset, MEMSET},
+                                  {HleRoutine::Dmul, DMUL},
+                                  {HleRoutine::Ddiv, DDIV}};
+        }
+
+        std::unique_ptr<Vm> vm = Vm::build(vmProperties);
+        vm->reset();
+        vm->load();
+
+        for (Interrupt interrupt = vm->run(); interrupt != Interrupt::Stop; interrupt = vm->run()) {
+        }
+
+        uint32_t sum = 0;
+
+        for (int routine = 0; routine < 4; routine++) {
+
+            const auto start = std::chrono::steady_clock::now();
+
+            // Doubles : 1.1 * (1 + i / 2^20) et son inverse par 3.
+            for (int i = 0; i < calls; i++) {
+                sum += routine == 0   ? vm->call(UIDIVMOD, 0xFFFFFFFF - i, 7 + i % 1000).m_r1
+                       : routine == 1 ? vm->call(MEMSET, BUFFER, i, 256).m_r0
+                       : routine == 2 ? vm->call(DMUL, 0x9999999A, 0x3FF19999, 0, 0x3FF00000 + i % 1000).m_r1
+                                      : vm->call(DDIV, 0, 0x3FF00000 + i % 1000, 0, 0x40080000).m_r1;
+            }
+
+            const double elapsed =
+                std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+            (hooked ? host : arm)[routine] = sum != 0 ? elapsed / calls : -1.0;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+
+    const int   repetitions = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 10;
+    std::string binPath(getBinPath());
+    int         status = 0;
+
+    for (const char *program : PROGRAMS) {
+
+        const uint64_t instructions = countInstructions(binPath + "/src/test_compile/" + program);
+        std::string    reference;
+
+        for (const Mode &mode : MODES) {
+
+            std::vector<double> times;
+
+            for (int i = 0; i < repetitions; i++) {
+
+                std::string  output;
+                const double elapsed = measure(binPath + "/src/test_compile/" + program, mode, output);
+
+                if (elapsed < 0.0) {
+
+                    std::fprintf(stderr, "%s: load failed\n", program);
+                    return 1;
+                }
+
+                if (reference.empty()) {
+                    reference = output;
+                } else if (output != reference) {
+
+                    std::fprintf(stderr, "%s: %s output differs from interpreter\n", program, mode.name);
+                    status = 1;
+                }
+
+                times.push_back(elapsed);
+            }
+
+            std::ranges::sort(times);
+
+            const double best   = times.front();
+            const double median = times[times.size() / 2];
+
+            std::printf("%-12s %-12s %8.3f ms, median %8.3f ms %7.2f ns/instruction\n", program, mode.name, best,
+                        median, instructions != 0 ? median * 1e6 / static_cast<double>(instructions) : 0.0);
+        }
+
+        double reload  = 0.0;
+        double restore = 0.0;
+        double fork    = 0.0;
+
+        measureReset(binPath + "/src/test_compile/" + program, repetitions, reload, restore, fork);
+        std::printf("%-12s reset+load %8.1f us, restore %8.1f us, fork %8.1f us\n", program, reload, restore, fork);
+    }
+
+    for (const Mode &mode : MODES) {
+        std::printf("%-12s %-12s %8.1f ns/call\n", "call", mode.name, measureCall(mode, repetitions * 10000));
+    }
+
+    for (const Mode &mode : MODES) {
+
+        double arm[4];
+        double host[4];
+
+        measureHle(binPath + "/src/test_compile/hello.bin", mode, repetitions * 1000, arm, host);
+        std::printf("%-12s %-12s uidivmod %7.1f -> %7.1f ns/call, memset(256) %7.1f -> %7.1f ns/call\n", "hle",
+                    mode.name, arm[0], host[0], arm[1], host[1]);
+        std::printf("%-12s %-12s dmul     %7.1f -> %7.1f ns/call, ddiv        %7.1f -> %7.1f ns/call\n", "hle",
+                    mode.name, arm[2], host[2], arm[3], host[3]);
+    }
+
+    return status;
+}
@@ -9,8 +9,11 @@ template class armv4vm::VmImplementation<armv4vm::MemoryProtected, armv4vm::Vfpv
 
 #include "testmem.hpp"
 #include "testvfp.hpp"
+#include "testdecoder.hpp"
 #include "testaluinstructionraw.hpp"
 #include "testaluinstructionprotected.hpp"
+#include "testaluinstructionguarded.hpp"
+#include "testaluinstructionmasked.hpp"
 #include "testaluprogramraw.hpp"
 #include "testaluprogramprotected.hpp"
 #include "testvfpinstructionraw.hpp"
@@ -25,6 +28,11 @@ int main(int argc, char** argv)
         status |= QTest::qExec(&tc, argc, argv);
     }
 
+    {
+        armv4vm::TestDecoder tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
     // Raw
     {
 
@@ -52,5 +60,19 @@ int main(int argc, char** argv)
         }
     }
 
+    // Masked
+    {
+        armv4vm::TestAluInstructionMasked tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+#if ARMV4VM_GUARDED
+    // Guarded
+    {
+        armv4vm::TestAluInstructionGuarded tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+#endif
+
     return status;
 }
@@ -21,6 +21,12 @@
 #include <QtTest>
 #include <iostream>
 #include <bit>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
 
 #include "config.h"
 #include "armv4vm.hpp"
@@ -49,11 +55,16 @@ class TestAluInstruction
     std::unique_ptr<Alu<T, Copro>> m_alu;
     VmProperties m_vmProperties;
 
+    // MemoryMasked replie les adresses au lieu de fauter.
+    static constexpr bool MASKED = requires { T::ADDRESS_MASK; };
+
 
   public:
     TestAluInstruction()
     {
-        m_vmProperties.m_memoryProperties.m_layout.push_back({0, 512, AccessPermission::READ_WRITE});
+        // MemoryGuarded ne protège que des pages entières.
+        m_vmProperties.m_memoryProperties.m_layout.push_back(
+            {0, std::is_same_v<T, MemoryProtected> ? 512 : 4_kb, AccessPermission::READ_WRITE});
         m_vmProperties.m_memoryProperties.m_memorySizeBytes = 1_kb;
 
         m_mem = std::make_unique<T>(m_vmProperties.m_memoryProperties);
@@ -2031,6 +2042,504 @@ class TestAluInstruction
         QVERIFY(m_alu->m_registers[2] == 0x00000010);
         QVERIFY(m_alu->m_cpsr == 0x60000000);
     }
+
+    void testPredecodeInvalidation() {
+
+        m_alu->reset();
+        m_alu->m_properties.m_executionMode = AluProperties::PREDECODED;
+
+        checkInvalidation(*m_alu);
+
+        m_alu->m_properties.m_executionMode = AluProperties::INTERPRETER;
+    }
+
+    void testBlockInvalidation() {
+
+        m_alu->reset();
+        m_alu->m_properties.m_executionMode = AluProperties::BLOCK;
+
+        checkInvalidation(*m_alu);
+
+        m_alu->m_properties.m_executionMode = AluProperties::INTERPRETER;
+    }
+
+    // Le str réécrit une instruction plus loin dans le même bloc en branchement :
+    // le bloc doit s'arrêter et la suite être retraduite.
+    void testBlockRewrittenBranch() {
+
+        for (const auto mode :
+             {AluProperties::INTERPRETER, AluProperties::PREDECODED, AluProperties::BLOCK, AluProperties::JIT}) {
+
+            m_alu->reset();
+            m_alu->m_properties.m_executionMode = mode;
+            m_alu->m_properties.m_jitThreshold  = 0;
+
+            m_alu->m_mem->template writePointer<uint32_t>(0x00) = 0xe59f100c; // ldr r1, [pc, #12]
+            m_alu->m_mem->template writePointer<uint32_t>(0x04) = 0xe58f1000; // str r1, [pc, #0]
+            m_alu->m_mem->template writePointer<uint32_t>(0x08) = 0xe3a00001; // mov r0, #1
+            m_alu->m_mem->template writePointer<uint32_t>(0x0C) = 0xe3a00002; // mov r0, #2
+            m_alu->m_mem->template writePointer<uint32_t>(0x10) = 0xeafffffe; // b   0x10
+            m_alu->m_mem->template writePointer<uint32_t>(0x14) = 0xea000001; // b   0x18 une fois en 0x0C
+            m_alu->m_mem->template writePointer<uint32_t>(0x18) = 0xe3a00003; // mov r0, #3
+            m_alu->m_mem->template writePointer<uint32_t>(0x1C) = 0xeafffffe; // b   0x1C
+
+            m_alu->run(6);
+            m_alu->m_properties.m_executionMode = AluProperties::INTERPRETER;
+
+            QVERIFY(m_alu->m_registers[0] == 3);
+            QVERIFY(m_alu->m_registers[15] == 0x1C);
+        }
+    }
+
+    // Un swi arrête run() juste après lui et rend son numéro ; non exécuté (condition fausse), il ne l'arrête pas.
+    void testSoftwareInterrupt() {
+
+        for (const auto mode : {AluProperties::INTERPRETER, AluProperties::PREDECODED, AluProperties::THREADED,
+                                AluProperties::BLOCK, AluProperties::JIT}) {
+
+            m_alu->reset();
+            m_alu->m_properties.m_executionMode = mode;
+            m_alu->m_properties.m_jitThreshold  = 0;
+
+            m_alu->m_mem->template writePointer<uint32_t>(0x00) = 0xe3a00001; // mov   r0, #1
+            m_alu->m_mem->template writePointer<uint32_t>(0x04) = 0x0f000002; // swieq 2
+            m_alu->m_mem->template writePointer<uint32_t>(0x08) = 0xef000003; // swi   3
+            m_alu->m_mem->template writePointer<uint32_t>(0x0C) = 0xe3a00002; // mov   r0, #2
+            m_alu->m_mem->template writePointer<uint32_t>(0x10) = 0xeafffffe; // b     0x10
+
+            QVERIFY(m_alu->run() == Interrupt::Suspend);
+            QVERIFY(m_alu->m_registers[0] == 1);
+            QVERIFY(m_alu->m_registers[15] == 0x0C);
+
+            QVERIFY(m_alu->run(3) == Interrupt::Undefined);
+            QVERIFY(m_alu->m_registers[0] == 2);
+            QVERIFY(m_alu->m_registers[15] == 0x10);
+        }
+
+        m_alu->m_properties = AluProperties();
+    }
+
+    void testRunResult() {
+
+        for (const auto mode : {AluProperties::INTERPRETER, AluProperties::PREDECODED, AluProperties::BLOCK,
+                                AluProperties::JIT}) {
+
+            m_alu->reset();
+            m_alu->m_properties.m_executionMode = mode;
+            m_alu->m_properties.m_jitThreshold  = 0;
+
+            checkRunResult(*m_alu);
+        }
+
+        m_alu->m_properties = AluProperties();
+
+        AluProperties properties;
+        properties.m_executionMode = AluProperties::THREADED;
+
+        Alu<T, Copro, Dispatch::THREADED> alu(properties);
+        alu.attach(m_mem.get());
+        alu.reset();
+
+        checkRunResult(alu);
+    }
+
+    void testRestore() {
+
+        for (const auto mode : {AluProperties::INTERPRETER, AluProperties::PREDECODED, AluProperties::BLOCK,
+                                AluProperties::JIT}) {
+
+            m_alu->reset();
+            m_alu->m_properties.m_executionMode = mode;
+            m_alu->m_properties.m_jitThreshold  = 0;
+
+            checkRestore(*m_alu);
+        }
+
+        m_alu->m_properties = AluProperties();
+
+        AluProperties properties;
+        properties.m_executionMode = AluProperties::THREADED;
+
+        Alu<T, Copro, Dispatch::THREADED> alu(properties);
+        alu.attach(m_mem.get());
+        alu.reset();
+
+        checkRestore(alu);
+    }
+
+    void testJitInvalidation() {
+
+        m_alu->reset();
+        m_alu->m_properties.m_executionMode = AluProperties::JIT;
+        m_alu->m_properties.m_jitThreshold  = 0;
+
+        checkInvalidation(*m_alu);
+
+        m_alu->m_properties.m_executionMode = AluProperties::INTERPRETER;
+    }
+
+    void testJitDataProcessing() {
+
+        AluProperties properties;
+        properties.m_executionMode = AluProperties::JIT;
+        properties.m_jitThreshold  = 0;
+
+        checkDataProcessing(properties);
+    }
+
+    void testThreadedInvalidation() {
+
+        AluProperties properties;
+        properties.m_executionMode = AluProperties::THREADED;
+
+        Alu<T, Copro, Dispatch::THREADED> alu(properties);
+        alu.attach(m_mem.get());
+        alu.reset();
+
+        checkInvalidation(alu);
+    }
+
+    // Deux mémoires parties de la même image : la page de code en lecture seule est décodée une fois pour les deux
+    // ALU (jamais avec MemoryRaw, où tout s'écrit). Une page modifiée par l'hôte ou invalidée redevient privée sans
+    // toucher au décodage partagé.
+    void testSharedPredecode() {
+
+        static constexpr bool SHARED = !std::is_same_v<T, MemoryRaw> && !MASKED;
+
+        MemoryProperties writable;
+        writable.m_layout          = {{0, 8_kb, AccessPermission::READ_WRITE}};
+        writable.m_memorySizeBytes = 8_kb;
+
+        T builder(writable);
+        builder.reset();
+        builder.template writePointer<uint32_t>(0x00) = 0xe3a01a01; // mov  r1, #0x1000
+        builder.template writePointer<uint32_t>(0x04) = 0xe3a05003; // mov  r5, #3
+        builder.template writePointer<uint32_t>(0x08) = 0xe5910000; // ldr  r0, [r1]
+        builder.template writePointer<uint32_t>(0x0C) = 0xe2800001; // add  r0, r0, #1
+        builder.template writePointer<uint32_t>(0x10) = 0xe5810000; // str  r0, [r1]
+        builder.template writePointer<uint32_t>(0x14) = 0xe2555001; // subs r5, r5, #1
+        builder.template writePointer<uint32_t>(0x18) = 0x1afffffa; // bne  0x08
+        builder.template writePointer<uint32_t>(0x1C) = 0xef000002; // swi  2
+
+        const std::shared_ptr<const MemoryImage> image = builder.image();
+
+        // Code en lecture seule, données à part.
+        MemoryProperties properties;
+        properties.m_layout          = {{0, 4_kb, AccessPermission::READ}, {4_kb, 4_kb, AccessPermission::READ_WRITE}};
+        properties.m_memorySizeBytes = 8_kb;
+
+        for (const auto mode : {AluProperties::PREDECODED, AluProperties::BLOCK}) {
+
+            AluProperties aluProperties;
+            aluProperties.m_executionMode = mode;
+
+            T              first(properties, image);
+            T              second(properties, image);
+            Alu<T, Copro>  alu1(aluProperties);
+            Alu<T, Copro>  alu2(aluProperties);
+
+            alu1.attach(&first);
+            alu2.attach(&second);
+            alu1.resume(AluState());
+            alu2.resume(AluState());
+
+            QVERIFY(alu1.run(0) == Interrupt::Stop);
+            QVERIFY(alu2.run(0) == Interrupt::Stop);
+            QVERIFY(first.template readPointer<uint32_t>(0x1000) == 3);
+            QVERIFY(second.template readPointer<uint32_t>(0x1000) == 3);
+            QVERIFY(alu1.m_predecode.isShared(0x00) == SHARED);
+            QVERIFY(alu2.m_predecode.isShared(0x00) == SHARED);
+            QVERIFY(!alu1.m_predecode.isShared(0x1000));
+
+            // mov r5, #5 écrit par l'hôte dans la première mémoire seulement.
+            write<uint32_t>(first.getAddressZero(), 0x04, 0xe3a05005);
+            first.markDirty(0x04, 4);
+            alu1.resume(AluState());
+            alu2.resume(AluState());
+
+            QVERIFY(alu1.run(0) == Interrupt::Stop);
+            QVERIFY(alu2.run(0) == Interrupt::Stop);
+            QVERIFY(first.template readPointer<uint32_t>(0x1000) == 8);
+            QVERIFY(second.template readPointer<uint32_t>(0x1000) == 6);
+            QVERIFY(!alu1.m_predecode.isShared(0x00));
+            QVERIFY(alu2.m_predecode.isShared(0x00) == SHARED);
+
+            // Invalidation d'une page empruntée : copie privée, la page partagée reste décodée.
+            QVERIFY(alu2.m_predecode.invalidate(0x08, 4));
+            QVERIFY(!alu2.m_predecode.isShared(0x00));
+            QVERIFY((alu2.m_predecode.entry(0x08)->handler == &Alu<T, Copro>::predecodeOp));
+
+            T             third(properties, image);
+            Alu<T, Copro> alu3(aluProperties);
+
+            alu3.attach(&third);
+            alu3.resume(AluState());
+            QVERIFY((alu3.m_predecode.entry(0x08)->handler != &Alu<T, Copro>::predecodeOp || !SHARED));
+            QVERIFY(alu3.run(0) == Interrupt::Stop);
+            QVERIFY(third.template readPointer<uint32_t>(0x1000) == 3);
+
+            // Page empruntée remplacée par sa copie privée pendant run() : la boucle ne lit plus l'ancienne page.
+            alu3.setSwiHandler(2, [&] {
+                write<uint32_t>(third.getAddressZero(), 0x20, 0xef000003); // swi 3
+                alu3.m_predecode.invalidate(0x20, 4);
+                return SwiAction::Continue;
+            });
+            alu3.resume(AluState());
+            QVERIFY(alu3.run(0) == Interrupt::Suspend);
+            QVERIFY(alu3.m_registers[15] == 0x24);
+        }
+
+        // ALU sur plusieurs threads, toutes sur une image neuve : les pages partagées sont décodées sous verrou.
+        const std::shared_ptr<const MemoryImage> fresh = builder.image();
+        std::vector<std::thread>                 pool;
+        std::atomic<int>                         done = 0;
+
+        for (int i = 0; i < 4; i++) {
+
+            pool.emplace_back([&]() {
+
+                AluProperties aluProperties;
+                aluProperties.m_executionMode = AluProperties::PREDECODED;
+
+                for (int round = 0; round < 16; round++) {
+
+                    T             memory(properties, fresh);
+                    Alu<T, Copro> alu(aluProperties);
+
+                    alu.attach(&memory);
+                    alu.resume(AluState());
+
+                    if (alu.run(0) == Interrupt::Stop && memory.template readPointer<uint32_t>(0x1000) == 3) {
+                        done++;
+                    }
+                }
+            });
+        }
+
+        for (std::thread &thread : pool) {
+            thread.join();
+        }
+
+        QVERIFY(done == 64);
+    }
+
+  private:
+    // Instructions retirées et PC de sortie ; avec la mémoire protégée, fautes de données et de fetch.
+    template <typename A>
+    void checkRunResult(A &alu) {
+
+        alu.m_mem->template writePointer<uint32_t>(0x00) = 0xe3a00001; // mov r0, #1
+        alu.m_mem->template writePointer<uint32_t>(0x04) = 0xe3a00002; // mov r0, #2
+        alu.m_mem->template writePointer<uint32_t>(0x08) = 0xef000003; // swi 3
+        alu.m_mem->template writePointer<uint32_t>(0x0C) = 0xe3a00003; // mov r0, #3
+        alu.m_mem->template writePointer<uint32_t>(0x10) = 0xeafffffe; // b   0x10
+        alu.flushCodeCaches();
+
+        RunResult result = alu.run(0, std::nothrow);
+        QVERIFY(result.m_interrupt == Interrupt::Suspend);
+        QVERIFY(result.m_instructions == 3);
+        QVERIFY(result.m_pc == 0x0C);
+        QVERIFY(!result.m_faulted);
+
+        result = alu.run(5, std::nothrow);
+        QVERIFY(result.m_interrupt == Interrupt::Undefined);
+        QVERIFY(result.m_instructions == 5);
+        QVERIFY(result.m_pc == 0x10);
+        QVERIFY(alu.m_registers[0] == 3);
+
+        if constexpr (MASKED) {
+
+            // Accès hors de l'espace de 8 Kio : repliés, sans faute. Un mot à cheval sur la fin lit la queue de garde.
+            alu.m_mem->template writePointer<uint32_t>(0x00) = 0xe3a01a02; // mov r1, #0x2000
+            alu.m_mem->template writePointer<uint32_t>(0x04) = 0xe5912000; // ldr r2, [r1]
+            alu.m_mem->template writePointer<uint32_t>(0x08) = 0xe5013004; // str r3, [r1, #-4]
+            alu.m_mem->template writePointer<uint32_t>(0x0C) = 0xe3a0fa04; // mov pc, #0x4000
+            alu.flushCodeCaches();
+            alu.m_registers[3]  = 0xeafffffe; // b .
+            alu.m_registers[15] = 0;
+
+            result = alu.run(6, std::nothrow);
+            QVERIFY(!result.m_faulted);
+            QVERIFY(alu.m_registers[2] == 0xe3a01a02);
+            QVERIFY(alu.m_mem->template readPointer<uint32_t>(0x1FFC) == 0xeafffffe);
+            QVERIFY(result.m_instructions == 6);
+            QVERIFY(result.m_pc == 0x4008);
+            QVERIFY(alu.m_mem->template readPointer<uint32_t>(0xFFFFFFFE) == 0xeaff);
+        } else if constexpr (!std::is_same_v<T, MemoryRaw>) {
+
+            alu.m_mem->template writePointer<uint32_t>(0x00) = 0xe3a01a01; // mov r1, #0x1000
+            alu.m_mem->template writePointer<uint32_t>(0x04) = 0xe5912000; // ldr r2, [r1]
+            alu.m_mem->template writePointer<uint32_t>(0x08) = 0xe3a0fa02; // mov pc, #0x2000
+            alu.flushCodeCaches();
+            alu.m_registers[15] = 0;
+
+            // Faute de donnée : l'instruction fautive n'est pas retirée.
+            result = alu.run(0, std::nothrow);
+            QVERIFY(result.m_interrupt == Interrupt::Fatal);
+            QVERIFY(result.m_instructions == 1);
+            QVERIFY(result.m_pc == 0x04);
+            QVERIFY(result.m_faulted);
+            QVERIFY(result.m_fault.m_address == 0x1000);
+            QVERIFY(result.m_fault.m_access == AccessPermission::READ);
+
+            // Le MMU ne donne pas la taille de l'accès.
+            QVERIFY(result.m_fault.m_size == (T::HOST_FAULTS ? 0 : 4));
+
+            // Faute de fetch une fois l'accès rendu possible.
+            alu.m_registers[1] = 0x100;
+            result             = alu.run(0, std::nothrow);
+            QVERIFY(result.m_interrupt == Interrupt::Fatal);
+            QVERIFY(result.m_instructions == 2);
+            QVERIFY(result.m_pc == 0x2000);
+            QVERIFY(result.m_fault.m_address == 0x2000);
+
+            // Faute d'écriture.
+            alu.m_mem->template writePointer<uint32_t>(0x04) = 0xe5812000; // str r2, [r1]
+            alu.flushCodeCaches();
+            alu.m_registers[15] = 0;
+
+            result = alu.run(0, std::nothrow);
+            QVERIFY(result.m_instructions == 1);
+            QVERIFY(result.m_pc == 0x04);
+            QVERIFY(result.m_fault.m_address == 0x1000);
+            QVERIFY(result.m_fault.m_access == AccessPermission::WRITE);
+
+            // run() sans nothrow lève toujours l'exception.
+            bool thrown = false;
+            try {
+                alu.run();
+            } catch (const MemoryFaultException &exception) {
+                thrown = exception.fault().m_address == 0x1000;
+            }
+            QVERIFY(thrown);
+        }
+    }
+
+    // Le programme modifie ses données et son propre code, dont le mot modifié finit décodé : après restore(), une
+    // seconde exécution doit repartir de l'instantané et non des caches.
+    template <typename A>
+    void checkRestore(A &alu) {
+
+        alu.m_mem->template writePointer<uint32_t>(0x00)  = 0xe3a01c01; // mov  r1, #0x100
+        alu.m_mem->template writePointer<uint32_t>(0x04)  = 0xe3a05002; // mov  r5, #2
+        alu.m_mem->template writePointer<uint32_t>(0x08)  = 0xe3a03001; // mov  r3, #1 (puis mov r3, #5)
+        alu.m_mem->template writePointer<uint32_t>(0x0C)  = 0xe0844003; // add  r4, r4, r3
+        alu.m_mem->template writePointer<uint32_t>(0x10)  = 0xe2555001; // subs r5, r5, #1
+        alu.m_mem->template writePointer<uint32_t>(0x14)  = 0x15912004; // ldrne r2, [r1, #4]
+        alu.m_mem->template writePointer<uint32_t>(0x18)  = 0x150120f8; // strne r2, [r1, #-0xF8]
+        alu.m_mem->template writePointer<uint32_t>(0x1C)  = 0xe5910000; // ldr  r0, [r1]
+        alu.m_mem->template writePointer<uint32_t>(0x20)  = 0xe2800001; // add  r0, r0, #1
+        alu.m_mem->template writePointer<uint32_t>(0x24)  = 0xe5810000; // str  r0, [r1]
+        alu.m_mem->template writePointer<uint32_t>(0x28)  = 0xe3550000; // cmp  r5, #0
+        alu.m_mem->template writePointer<uint32_t>(0x2C)  = 0x1afffff5; // bne  0x08
+        alu.m_mem->template writePointer<uint32_t>(0x30)  = 0xef000002; // swi  2
+        alu.m_mem->template writePointer<uint32_t>(0x100) = 40;
+        alu.m_mem->template writePointer<uint32_t>(0x104) = 0xe3a03005; // mov  r3, #5
+        alu.flushCodeCaches();
+        alu.m_mem->capture();
+
+        for (int round = 0; round < 2; round++) {
+
+            QVERIFY(alu.run(0) == Interrupt::Stop);
+            QVERIFY(alu.m_registers[4] == 6);
+            QVERIFY(alu.m_mem->template readPointer<uint32_t>(0x100) == 42);
+            QVERIFY(alu.m_mem->template readPointer<uint32_t>(0x08) == 0xe3a03005);
+
+            alu.restore();
+            QVERIFY(alu.m_registers[4] == 0);
+            QVERIFY(alu.m_registers[15] == 0);
+            QVERIFY(alu.m_mem->template readPointer<uint32_t>(0x100) == 40);
+            QVERIFY(alu.m_mem->template readPointer<uint32_t>(0x08) == 0xe3a03001);
+        }
+    }
+
+    // Traitements de données tirés au hasard (conditions, S, décalages immédiats, retenue entrante) :
+    // registres et CPSR doivent finir exactement comme avec l'interpréteur par défaut.
+    void checkDataProcessing(AluProperties properties) {
+
+        static constexpr uint32_t COUNT = 16;
+
+        Alu<T, Copro> candidate(properties);
+        candidate.attach(m_mem.get());
+
+        // Même programme, mêmes registres de départ ; registres et CPSR à l'arrivée.
+        const auto execute = [this](auto &alu, const auto &program, const auto &registers, const uint32_t cpsr) {
+
+            alu.reset();
+
+            for (uint32_t i = 0; i < COUNT; i++) {
+                m_mem->template writePointer<uint32_t>(i * 4) = program[i];
+            }
+            m_mem->template writePointer<uint32_t>(COUNT * 4) = 0xeafffffe; // b .
+
+            std::copy(registers.begin(), registers.end(), alu.m_registers.begin());
+            alu.m_cpsr = cpsr;
+
+            alu.run(COUNT + 1);
+
+            return std::make_pair(alu.m_registers, alu.m_cpsr);
+        };
+
+        m_alu->m_properties = AluProperties();
+
+        uint32_t random = 0x2468ACE1;
+
+        const auto next = [&random]() {
+
+            random = random * 1664525 + 1013904223;
+            return random;
+        };
+
+        for (int round = 0; round < 200; round++) {
+
+            std::array<uint32_t, COUNT> program;
+            std::array<uint32_t, 15>    registers;
+            const uint32_t              cpsr = next() & 0xF0000000;
+
+            for (uint32_t &instruction : program) {
+
+                const uint32_t condition = next() % 15;
+                const uint32_t rd        = next() % 13;
+
+                instruction = (condition << 28) | (next() & 0x03FF0FFF) | (rd << 12);
+
+                // Décalage par registre et formats voisins (multiply, swp, ldrh) exclus.
+                if ((instruction & 0x02000000) == 0) {
+                    instruction &= ~0x10u;
+                }
+
+                // tst, teq, cmp et cmn sans S sont des instructions PSR.
+                if (BITS(instruction, 23, 24) == 2) {
+                    instruction |= 0x00100000;
+                }
+            }
+
+            for (uint32_t &value : registers) {
+                value = next() % 4 == 0 ? next() & 0x80000001 : next();
+            }
+
+            QVERIFY(execute(*m_alu, program, registers, cpsr) == execute(candidate, program, registers, cpsr));
+        }
+    }
+
+    template <typename A>
+    void checkInvalidation(A &alu) {
+
+        alu.m_mem->template writePointer<uint32_t>(0x00) = 0xe3a00001; // mov r0, #1
+        alu.m_mem->template writePointer<uint32_t>(0x04) = 0xe59f1008; // ldr r1, [pc, #8]
+        alu.m_mem->template writePointer<uint32_t>(0x08) = 0xe50f1010; // str r1, [pc, #-16]
+        alu.m_mem->template writePointer<uint32_t>(0x0C) = 0xeafffffb; // b   0x00
+        alu.m_mem->template writePointer<uint32_t>(0x14) = 0xe3a00002; // mov r0, #2
+
+        alu.run(4);
+        QVERIFY(alu.m_registers[0] == 1);
+        QVERIFY(alu.m_registers[15] == 0);
+
+        // Le mov r0, #1 déjà décodé a été écrasé par le str.
+        alu.run(1);
+        QVERIFY(alu.m_registers[0] == 2);
+        QVERIFY(alu.m_registers[15] == 4);
+    }
 };
 
 template<typename T>
@@ -2050,9 +2559,10 @@ class TestAluProgram {
 
   public:
 
-    void testProgramHello() {
+    void testProgramHello(const AluProperties::ExecutionMode mode = AluProperties::INTERPRETER) {
 
         VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
         std::string binPath(getBinPath());
         std::string data;
 
@@ -2091,9 +2601,10 @@ class TestAluProgram {
         QVERIFY(data == "hello world\n");
     }
 
-    void testProgramPrimeN() {
+    void testProgramPrimeN(const AluProperties::ExecutionMode mode = AluProperties::INTERPRETER) {
 
         VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
 
         std::string binPath(getBinPath());
         vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
@@ -2130,9 +2641,10 @@ class TestAluProgram {
         QVERIFY(*(uint32_t *)(uart) == 2999);
     }
 
-    void testProgramFloat() {
+    void testProgramFloat(const AluProperties::ExecutionMode mode = AluProperties::INTERPRETER) {
 
         VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
         std::string binPath(getBinPath());
         vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
         vmProperties.m_bin     = binPath + "/src/test_compile/float.bin";
@@ -2178,9 +2690,10 @@ class TestAluProgram {
         QVERIFY(*(uint64_t *)(uart + 21) == 0x2bdb9cf8d41aef);
     }
 
-    void testProgramPrintf() {
+    void testProgramPrintf(const AluProperties::ExecutionMode mode = AluProperties::INTERPRETER) {
 
         VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
         std::string binPath(getBinPath());
         vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
         vmProperties.m_bin     = binPath + "/src/test_compile/printf.bin";
@@ -2220,9 +2733,68 @@ class TestAluProgram {
         QVERIFY(data == "[printf] 2 c hello 41.123000\n[cout] 2 c hello 41.123\n");
     }
 
-    void testProgramModulo() {
+    // Une VM arrêtée sur le premier caractère de printf.bin, runtime C initialisé, est figée puis reprise par des
+    // VM issues de fork() : chacune doit sortir la suite, puis la ressortir après restore().
+    void testProgramFork(const AluProperties::ExecutionMode mode   = AluProperties::INTERPRETER,
+                         const MemoryProperties::Type       memory = MemoryProperties::RAW) {
+
+        VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
+        vmProperties.m_bin                           = std::string(getBinPath()) + "/src/test_compile/printf.bin";
+
+        if (memory != MemoryProperties::RAW) {
+
+            // rom (code, data, bss), ram, stack, uart
+            vmProperties.m_memoryProperties.m_layout = {{0x00000000, 4_mb, AccessPermission::READ_WRITE},
+                                                        {0x00400000, 8_mb, AccessPermission::READ_WRITE},
+                                                        {0x00C00000, 4_mb, AccessPermission::READ_WRITE},
+                                                        {0x01000000, 1_mb, AccessPermission::READ_WRITE}};
+            vmProperties.m_memoryProperties.m_type   = memory;
+        } else {
+            vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+        }
+
+        const auto output = [](Vm &vm) {
+
+            std::byte  *uart = vm.getAddressZero() + UARTPOS;
+            std::string data;
+
+            for (Interrupt interrupt = vm.run(); interrupt != Interrupt::Stop; interrupt = vm.run()) {
+
+                if (interrupt == Interrupt::Suspend) {
+                    data += static_cast<char>(*uart);
+                }
+            }
+
+            return data;
+        };
+
+        std::unique_ptr<Vm> vm = Vm::build(vmProperties);
+        vm->reset();
+        QVERIFY(vm->load());
+        QVERIFY(vm->run() == Interrupt::Suspend);
+
+        std::byte                        *uart     = vm->getAddressZero() + UARTPOS;
+        const std::string                 first    = std::string(1, static_cast<char>(*uart));
+        std::shared_ptr<const VmSnapshot> snapshot = vm->snapshot();
+        const std::string                 rest     = output(*vm);
+
+        QVERIFY(first + rest == "[printf] 2 c hello 41.123000\n[cout] 2 c hello 41.123\n");
+
+        for (int i = 0; i < 3; i++) {
+
+            std::unique_ptr<Vm> fork = Vm::fork(snapshot);
+
+            QVERIFY(output(*fork) == rest);
+            fork->restore();
+            QVERIFY(output(*fork) == rest);
+        }
+    }
+
+    void testProgramModulo(const AluProperties::ExecutionMode mode = AluProperties::INTERPRETER) {
 
         VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
         std::string binPath(getBinPath());
         vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
         vmProperties.m_bin     = binPath + "/src/test_compile/modulo.bin";
@@ -2258,9 +2830,10 @@ class TestAluProgram {
                //QVERIFY(m_alu->m_registers[0] == 0);
     }
 
-    void testProgramBench() {
+    void testProgramBench(const AluProperties::ExecutionMode mode = AluProperties::INTERPRETER) {
 
         VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
         std::string binPath(getBinPath());
         vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
         vmProperties.m_bin     = binPath + "/src/test_compile/bench.bin";
@@ -2299,6 +2872,820 @@ class TestAluProgram {
         }
         QVERIFY(data == "4 11337 64624 74501 98671 149983 166011 167964 230031 276464 290271 343718 353417 378247 433098 443959 447113 449806 456279");
     }
+
+    // Des VM indépendantes exécutées en même temps sur un pool de threads doivent sortir exactement
+    // ce que sort une VM seule : aucun état d'exécution n'est partagé entre instances.
+    void testProgramConcurrent(const AluProperties::ExecutionMode mode = AluProperties::INTERPRETER) {
+
+        static constexpr std::size_t VM_COUNT = 64;
+
+        const std::string binPath(getBinPath());
+        const char       *programs[] = {"printf.bin", "primen.bin", "bench.bin"};
+
+        const auto execute = [&](const char *program) {
+
+            VmProperties vmProperties;
+            vmProperties.m_aluProperties.m_executionMode      = mode;
+            vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+            vmProperties.m_bin                                = binPath + "/src/test_compile/" + program;
+
+            std::unique_ptr<Vm> vm      = Vm::build(vmProperties);
+            std::byte          *mem     = vm->reset();
+            std::byte          *uart    = nullptr;
+            bool                running = vm->load() != 0;
+            std::string         output;
+
+            uart = mem + UARTPOS;
+
+            while (running) {
+
+                switch (vm->run()) {
+
+                case Interrupt::Stop:
+                    running = false;
+                    break;
+
+                case Interrupt::Suspend:
+                    output += static_cast<char>(*uart);
+                    break;
+
+                default:
+                    break;
+                }
+            }
+
+            // primen.bin rend son résultat dans l'UART sans l'afficher.
+            return output + std::to_string(*reinterpret_cast<uint32_t *>(uart));
+        };
+
+        std::vector<std::string> references;
+        for (const char *program : programs) {
+            references.push_back(execute(program));
+        }
+
+        std::vector<std::string> outputs(VM_COUNT);
+        std::atomic<std::size_t> next = 0;
+        std::vector<std::thread> pool;
+
+        for (unsigned int i = 0; i < std::max(4u, std::thread::hardware_concurrency()); i++) {
+
+            pool.emplace_back([&]() {
+
+                for (std::size_t vm = next++; vm < VM_COUNT; vm = next++) {
+                    outputs[vm] = execute(programs[vm % std::size(programs)]);
+                }
+            });
+        }
+
+        for (std::thread &thread : pool) {
+            thread.join();
+        }
+
+        for (std::size_t vm = 0; vm < VM_COUNT; vm++) {
+            QVERIFY(outputs[vm] == references[vm % std::size(programs)]);
+        }
+    }
+
+    // hello.bin relié comme un ELF : le programme et 64 Kio de .bss à l'adresse 0, un saut vers 0 comme point
+    // d'entrée dans un second segment en lecture seule. La sortie doit être celle du binaire brut, .bss compris.
+    void testProgramElf(const AluProperties::ExecutionMode mode   = AluProperties::INTERPRETER,
+                        const MemoryProperties::Type       memory = MemoryProperties::RAW) {
+
+        static constexpr uint32_t ENTRY = 0x00300000;
+        static constexpr uint32_t BSS   = 0x10000;
+
+        const std::string path = std::string(getBinPath()) + "/src/test_compile/hello.bin";
+        const std::string elf  = (std::filesystem::temp_directory_path() / "armv4vm_testprogramelf.elf").string();
+        std::ifstream     file(path, std::ios::in | std::ios::binary);
+        std::vector<char> hello((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        const uint32_t   size   = static_cast<uint32_t>(hello.size());
+        const uint32_t   branch = 0xEA000000 | (((0 - (ENTRY + 8)) >> 2) & 0x00FFFFFF); // b 0
+        std::vector<char> jump(4);
+
+        std::memcpy(jump.data(), &branch, 4);
+        writeElf(elf, ENTRY, {{0, size + BSS, 7, hello}, {ENTRY, 4, 5, jump}}, {{"reset", 0}, {"$a", 0}, {"jump", ENTRY}});
+
+        std::shared_ptr<const Program> program = ProgramCache::load(elf);
+
+        QVERIFY(program != nullptr);
+        QVERIFY(program->m_entry == ENTRY);
+        QVERIFY(program->symbol("jump") == ENTRY);
+        QVERIFY(program->symbol("reset") == 0u);
+        QVERIFY(!program->symbol("$a"));
+        QVERIFY(program->m_image->size() == ENTRY + 4);
+        // .bss : étendue de l'image, absent de ses pages.
+        QVERIFY(program->m_image->pages().size() == (size + 4095) / 4096 + 1);
+
+        const std::vector<MemoryLayout> layout = program->layout();
+
+        QVERIFY(layout.size() == 2);
+        QVERIFY(layout[0].start == 0 && layout[0].size == ((size + BSS + 4095) & ~4095u));
+        QVERIFY(layout[0].permission == AccessPermission::READ_WRITE);
+        QVERIFY(layout[1].start == ENTRY && layout[1].size == 4096 && layout[1].permission == AccessPermission::READ);
+
+        VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
+        vmProperties.m_bin                           = elf;
+
+        if (memory != MemoryProperties::RAW) {
+
+            // segments, puis ram, stack, uart
+            vmProperties.m_memoryProperties.m_layout = layout;
+            vmProperties.m_memoryProperties.m_layout.push_back({0x00400000, 8_mb, AccessPermission::READ_WRITE});
+            vmProperties.m_memoryProperties.m_layout.push_back({0x00C00000, 4_mb, AccessPermission::READ_WRITE});
+            vmProperties.m_memoryProperties.m_layout.push_back({0x01000000, 1_mb, AccessPermission::READ_WRITE});
+            vmProperties.m_memoryProperties.m_type = memory;
+        } else {
+            vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+        }
+
+        const auto output = [](Vm &vm) {
+
+            std::byte  *uart = vm.getAddressZero() + UARTPOS;
+            std::string data;
+
+            for (Interrupt interrupt = vm.run(); interrupt != Interrupt::Stop; interrupt = vm.run()) {
+
+                if (interrupt == Interrupt::Suspend) {
+                    data += static_cast<char>(*uart);
+                }
+            }
+
+            return data;
+        };
+
+        std::unique_ptr<Vm> vm = Vm::build(vmProperties);
+        std::byte          *mem = vm->reset();
+
+        // Reste d'une exécution précédente : le .bss doit revenir à zéro au chargement.
+        std::memset(mem + size, 0xA5, BSS);
+        vm->markDirty(size, BSS);
+
+        QVERIFY(vm->load());
+        QVERIFY(vm->program() == program);
+        // Première instruction : le saut du point d'entrée.
+        QVERIFY(vm->run(1, std::nothrow).m_pc == 0);
+        QVERIFY(std::all_of(mem + size, mem + size + BSS, [](const std::byte value) { return value == std::byte{0}; }));
+        QVERIFY(output(*vm) == "hello world\n");
+
+        vm->restore();
+        QVERIFY(output(*vm) == "hello world\n");
+
+        // Segment qui déborde du fichier : le chargement échoue.
+        std::filesystem::resize_file(elf, 52 + 2 * 32 + 16);
+        QVERIFY(!vm->load());
+
+        ProgramCache::clear();
+        std::filesystem::remove(elf);
+    }
+
+    // Fonctions invitées appelées par l'hôte une fois la pile posée : six arguments (deux sur la pile), un swi au
+    // milieu d'un appel, registres rendus dans leur état d'avant l'appel.
+    void testCall(const AluProperties::ExecutionMode mode   = AluProperties::INTERPRETER,
+                  const MemoryProperties::Type       memory = MemoryProperties::RAW) {
+
+        VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
+
+        // Page en lecture seule au sommet : le trampoline par défaut reste sur le dernier mot inscriptible.
+        if (memory != MemoryProperties::RAW) {
+            vmProperties.m_memoryProperties.m_layout = {{0, 64_kb, AccessPermission::READ_WRITE},
+                                                        {64_kb, 4_kb, AccessPermission::READ}};
+            vmProperties.m_memoryProperties.m_type   = memory;
+        } else {
+            vmProperties.m_memoryProperties.m_memorySizeBytes = 64_kb;
+        }
+
+        std::unique_ptr<Vm> vm  = Vm::build(vmProperties);
+        std::byte          *mem = vm->reset();
+
+        const std::vector<std::pair<uint32_t, uint32_t>> code = {
+            {0x0000, 0xe3a0d902}, // mov sp, #0x8000
+            {0x0004, 0xef000003}, // swi 3
+            {0x1000, 0xe0800001}, // add r0, r0, r1
+            {0x1004, 0xe0800002}, // add r0, r0, r2
+            {0x1008, 0xe0800003}, // add r0, r0, r3
+            {0x100C, 0xe59d2000}, // ldr r2, [sp]
+            {0x1010, 0xe0800002}, // add r0, r0, r2
+            {0x1014, 0xe59d2004}, // ldr r2, [sp, #4]
+            {0x1018, 0xe0800002}, // add r0, r0, r2
+            {0x101C, 0xe1a0100d}, // mov r1, sp
+            {0x1020, 0xe1a0f00e}, // mov pc, lr
+            {0x1100, 0xef000003}, // swi 3
+            {0x1104, 0xe3a00007}, // mov r0, #7
+            {0x1108, 0xe1a0f00e}, // mov pc, lr
+        };
+
+        for (const auto &[address, instruction] : code) {
+            write<uint32_t>(mem, address, instruction);
+        }
+
+        // Code de démarrage : pose la pile.
+        QVERIFY(vm->run() == Interrupt::Suspend);
+
+        CallResult result = vm->call(0x1000, 1, 2, 3, 4, 5, 6);
+        QVERIFY(result.m_run.m_interrupt == Interrupt::Return);
+        QVERIFY(read<uint32_t>(mem, 64_kb - 4) == 0xef00000a);
+        QVERIFY(result.m_r0 == 21);
+        QVERIFY(result.m_r1 == 0x8000 - 8);
+        QVERIFY(vm->snapshot()->m_state.m_registers[13] == 0x8000);
+        QVERIFY(vm->snapshot()->m_state.m_registers[15] == 0x8);
+
+        // Appels répétés, aucun argument sur la pile : pile inchangée.
+        for (uint32_t i = 0; i < 100; i++) {
+
+            result = vm->call(0x1000, i, i, 0, 0, 0, 0);
+            QVERIFY(result.m_r0 == 2 * i);
+        }
+
+        result = vm->call(0x1100);
+        QVERIFY(result.m_run.m_interrupt == Interrupt::Suspend);
+        result = vm->resumeCall();
+        QVERIFY(result.m_run.m_interrupt == Interrupt::Return);
+        QVERIFY(result.value() == 7);
+
+        // Le trampoline écrasé par l'invité est replanté.
+        write<uint32_t>(mem, 64_kb - 4, 0);
+        vm->markDirty(64_kb - 4, 4);
+        QVERIFY(vm->call(0x1000, 1, 1, 1, 1, 1, 1).m_r0 == 6);
+
+        // Arguments empilés dans la page en lecture seule : faute rendue par call(), registres inchangés.
+        if (memory != MemoryProperties::RAW) {
+
+            vm->registers()[13] = 64_kb + 4_kb;
+            result              = vm->call(0x1000, 1, 2, 3, 4, 5, 6);
+
+            QVERIFY(result.m_run.m_interrupt == Interrupt::Fatal && result.m_run.m_faulted);
+            QVERIFY(result.m_run.m_fault.m_address == 64_kb + 4_kb - 8);
+            QVERIFY(result.m_run.m_fault.m_access == AccessPermission::WRITE);
+            QVERIFY(vm->registers()[13] == 64_kb + 4_kb);
+
+            vm->registers()[13] = 0x8000;
+            QVERIFY(vm->call(0x1000, 1, 2, 3, 4, 5, 6).m_r0 == 21);
+        }
+
+        // Trampoline choisi : non aligné, hors de la mémoire ou en lecture seule, refusé par Vm::build.
+        for (const uint64_t trampoline : {uint64_t{0x2002}, 64_kb, 64_kb + 4_kb}) {
+
+            vmProperties.m_trampoline = static_cast<uint32_t>(trampoline);
+
+            bool caught = false;
+            try {
+                Vm::build(vmProperties);
+            } catch (const VmException &) {
+                caught = true;
+            }
+            QVERIFY(caught);
+        }
+
+        vmProperties.m_trampoline = 0x2000;
+        vm                        = Vm::build(vmProperties);
+        mem                       = vm->reset();
+
+        for (const auto &[address, instruction] : code) {
+            write<uint32_t>(mem, address, instruction);
+        }
+
+        QVERIFY(vm->run() == Interrupt::Suspend);
+        QVERIFY(vm->call(0x1000, 1, 2, 3, 4, 5, 6).m_r0 == 21);
+        QVERIFY(read<uint32_t>(mem, 0x2000) == 0xef00000a);
+
+        // Périphérique à la fin de la plage : le trampoline par défaut passe sous ses registres.
+        if (memory == MemoryProperties::PROTECTED) {
+
+            vmProperties.m_trampoline                 = std::nullopt;
+            vmProperties.m_memoryProperties.m_devices = {
+                {64_kb - 16, 16, [](uint32_t, uint32_t) -> uint32_t { return 0; }, [](uint32_t, uint32_t, uint32_t) {}}};
+            vm  = Vm::build(vmProperties);
+            mem = vm->reset();
+
+            for (const auto &[address, instruction] : code) {
+                write<uint32_t>(mem, address, instruction);
+            }
+
+            QVERIFY(vm->run() == Interrupt::Suspend);
+            QVERIFY(vm->call(0x1000, 1, 2, 3, 4, 5, 6).m_r0 == 21);
+            QVERIFY(read<uint32_t>(mem, 64_kb - 20) == 0xef00000a);
+        }
+
+        // Aucun mot inscriptible : le trampoline par défaut reste sur le dernier mot, call() y rend la faute.
+        if (memory != MemoryProperties::RAW) {
+
+            vmProperties.m_trampoline                 = std::nullopt;
+            vmProperties.m_memoryProperties.m_devices = {};
+            vmProperties.m_memoryProperties.m_layout  = {{0, 64_kb, AccessPermission::READ}};
+            vm                                        = Vm::build(vmProperties);
+            vm->reset();
+
+            result = vm->call(0x1000);
+            QVERIFY(result.m_run.m_interrupt == Interrupt::Fatal && result.m_run.m_faulted);
+            QVERIFY(result.m_run.m_fault.m_address == 64_kb - 4);
+            QVERIFY(result.m_run.m_fault.m_access == AccessPermission::WRITE);
+        }
+    }
+
+    // Sortie UART de hello.bin servie par un gestionnaire de swi : un seul run() jusqu'à Stop. Un gestionnaire qui
+    // rend la main ressort comme un swi sans gestionnaire ; une VM issue de fork() garde les gestionnaires.
+    void testSwiHandlers(const AluProperties::ExecutionMode mode   = AluProperties::INTERPRETER,
+                         const MemoryProperties::Type       memory = MemoryProperties::RAW) {
+
+        std::string output;
+        int         yields = 0;
+
+        VmProperties vmProperties;
+        vmProperties.m_aluProperties.m_executionMode = mode;
+        vmProperties.m_bin                           = std::string(getBinPath()) + "/src/test_compile/hello.bin";
+
+        if (memory != MemoryProperties::RAW) {
+
+            // rom (code, data, bss), ram, stack, uart
+            vmProperties.m_memoryProperties.m_layout = {{0x00000000, 4_mb, AccessPermission::READ_WRITE},
+                                                        {0x00400000, 8_mb, AccessPermission::READ_WRITE},
+                                                        {0x00C00000, 4_mb, AccessPermission::READ_WRITE},
+                                                        {0x01000000, 1_mb, AccessPermission::READ_WRITE}};
+            vmProperties.m_memoryProperties.m_type   = memory;
+        } else {
+            vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+        }
+
+        vmProperties.m_swiHandlers[static_cast<uint32_t>(Interrupt::Suspend)] = [&output, &yields](Vm &vm) {
+
+            const char character = static_cast<char>(vm.getAddressZero()[0x01000000]);
+
+            output += character;
+            return character == ' ' && yields++ == 0 ? SwiAction::Yield : SwiAction::Continue;
+        };
+
+        std::unique_ptr<Vm> vm = Vm::build(vmProperties);
+        vm->reset();
+        QVERIFY(vm->load());
+
+        const std::shared_ptr<const VmSnapshot> snapshot = vm->snapshot();
+
+        QVERIFY(vm->run() == Interrupt::Suspend);
+        QVERIFY(output == "hello ");
+        QVERIFY(vm->run() == Interrupt::Stop);
+        QVERIFY(output == "hello world\n");
+
+        output.clear();
+
+        std::unique_ptr<Vm> forked = Vm::fork(snapshot);
+        QVERIFY(forked->run() == Interrupt::Stop);
+        QVERIFY(output == "hello world\n");
+
+        // Numéro hors de la table.
+        vmProperties.m_swiHandlers[256] = [](Vm &) { return SwiAction::Continue; };
+
+        bool caught = false;
+        try {
+            Vm::build(vmProperties);
+        } catch (const VmException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+    }
+
+    // Routines de hello.bin remplacées par l'hôte, liées par les symboles d'un ELF (alias de libgcc compris) ou par
+    // adresse pour le binaire brut : même sortie en moins d'instructions. Puis chaque routine est appelée avec les
+    // mêmes arguments dans la VM remplacée et dans une VM sans remplacement : mêmes registres, mêmes octets.
+    void testHle(const AluProperties::ExecutionMode mode   = AluProperties::INTERPRETER,
+                 const MemoryProperties::Type       memory = MemoryProperties::RAW) {
+
+        // Routines de hello.bin (newlib, libgcc).
+        static constexpr uint32_t MEMCPY   = 0x11024;
+        static constexpr uint32_t MEMSET   = 0x9070;
+        static constexpr uint32_t STRLEN   = 0x111b4;
+        static constexpr uint32_t UIDIV    = 0x27f4c;
+        static constexpr uint32_t UIDIVMOD = 0x28040;
+        static constexpr uint32_t IDIV     = 0x28060;
+        static constexpr uint32_t IDIVMOD  = 0x28188;
+        static constexpr uint32_t BUFFER   = 0x00500000; // ram
+        static constexpr uint32_t BSS      = 0x10000;
+
+        const std::string path = std::string(getBinPath()) + "/src/test_compile/hello.bin";
+        const std::string elf  = (std::filesystem::temp_directory_path() / "armv4vm_testhle.elf").string();
+        std::ifstream     file(path, std::ios::in | std::ios::binary);
+        std::vector<char> hello((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        writeElf(elf, 0, {{0, static_cast<uint32_t>(hello.size()) + BSS, 7, hello}},
+                 {{"memcpy", MEMCPY},
+                  {"memset", MEMSET},
+                  {"strlen", STRLEN},
+                  {"__udivsi3", UIDIV},
+                  {"__aeabi_uidivmod", UIDIVMOD},
+                  {"__divsi3", IDIV},
+                  {"__aeabi_idivmod", IDIVMOD}});
+
+        const auto build = [&](const std::string &bin, const std::vector<HleHook> &hle) {
+
+            VmProperties vmProperties;
+            vmProperties.m_aluProperties.m_executionMode = mode;
+            vmProperties.m_bin                           = bin;
+            vmProperties.m_hle                           = hle;
+
+            if (memory != MemoryProperties::RAW) {
+
+                // rom (code, data, bss), ram, stack, uart
+                vmProperties.m_memoryProperties.m_layout = {{0x00000000, 4_mb, AccessPermission::READ_WRITE},
+                                                            {0x00400000, 8_mb, AccessPermission::READ_WRITE},
+                                                            {0x00C00000, 4_mb, AccessPermission::READ_WRITE},
+                                                            {0x01000000, 1_mb, AccessPermission::READ_WRITE}};
+                vmProperties.m_memoryProperties.m_type   = memory;
+            } else {
+                vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+            }
+
+            std::unique_ptr<Vm> vm = Vm::build(vmProperties);
+            vm->reset();
+            return vm;
+        };
+
+        // Sortie UART jusqu'à Stop et nombre d'instructions invitées.
+        const auto output = [](Vm &vm, uint64_t &instructions) {
+
+            std::string data;
+
+            instructions = 0;
+
+            for (RunResult result = vm.run(0, std::nothrow);; result = vm.run(0, std::nothrow)) {
+
+                instructions += result.m_instructions;
+
+                if (result.m_interrupt == Interrupt::Stop) {
+                    return data;
+                }
+                if (result.m_interrupt == Interrupt::Suspend) {
+                    data += static_cast<char>(vm.getAddressZero()[0x01000000]);
+                }
+            }
+        };
+
+        const std::vector<HleHook> all = {{HleRoutine::Memcpy, std::nullopt},  {HleRoutine::Memset, std::nullopt},
+                                          {HleRoutine::Strlen, std::nullopt},  {HleRoutine::Uidiv, std::nullopt},
+                                          {HleRoutine::Uidivmod, std::nullopt}, {HleRoutine::Idiv, std::nullopt},
+                                          {HleRoutine::Idivmod, std::nullopt}};
+
+        std::unique_ptr<Vm> plain  = build(path, {});
+        std::unique_ptr<Vm> hooked = build(elf, all);
+        std::unique_ptr<Vm> manual = build(path, {{HleRoutine::Memset, MEMSET}});
+        uint64_t            reference = 0;
+        uint64_t            fewer     = 0;
+
+        QVERIFY(plain->load() && hooked->load() && manual->load());
+        QVERIFY(output(*plain, reference) == "hello world\n");
+        QVERIFY(output(*hooked, fewer) == "hello world\n");
+        QVERIFY(fewer < reference);
+        QVERIFY(output(*manual, fewer) == "hello world\n");
+        QVERIFY(fewer < reference);
+
+        // Le remplacement fait partie de l'état rétabli par restore().
+        hooked->restore();
+        QVERIFY(output(*hooked, fewer) == "hello world\n");
+        QVERIFY(fewer < reference);
+
+        // Une VM issue de fork() part de l'image remplacée et retrouve ses routines : le swi, puis le trampoline.
+        std::unique_ptr<Vm> forked   = Vm::fork(hooked->snapshot());
+        const CallResult    quotient = forked->call(IDIV, static_cast<uint32_t>(-100), 7);
+
+        QVERIFY(quotient.m_run.m_interrupt == Interrupt::Return);
+        QVERIFY(quotient.m_r0 == static_cast<uint32_t>(-14));
+        QVERIFY(quotient.m_run.m_instructions <= 2);
+
+        // Appels comparés, la pile de hello.bin restant en place après Stop.
+        const auto compare = [&](const uint32_t address, const std::array<uint32_t, 3> &arguments,
+                                 const bool twoResults) {
+
+            const CallResult expected = plain->call(address, arguments[0], arguments[1], arguments[2]);
+            const CallResult result   = hooked->call(address, arguments[0], arguments[1], arguments[2]);
+
+            return expected.m_run.m_interrupt == Interrupt::Return && result.m_run.m_interrupt == Interrupt::Return &&
+                   result.m_run.m_instructions < expected.m_run.m_instructions && result.m_r0 == expected.m_r0 &&
+                   (!twoResults || result.m_r1 == expected.m_r1) &&
+                   std::memcmp(plain->getAddressZero() + BUFFER, hooked->getAddressZero() + BUFFER, 256) == 0;
+        };
+
+        std::vector<std::pair<uint32_t, uint32_t>> operands = {
+            {0, 0},          {7, 0},          {0xFFFFFFF9, 0}, {0x80000000, 0xFFFFFFFF}, {0x80000000, 1},
+            {100, 7},        {0xFFFFFF9C, 7}, {100, 0xFFFFFFF9}, {0xFFFFFF9C, 0xFFFFFFF9}, {0xFFFFFFFF, 1},
+            {0xFFFFFFFF, 0xFFFFFFFF}, {12345, 12346}, {1, 0x80000000}};
+
+        // Opérandes pseudo-aléatoires, diviseurs de toutes tailles.
+        for (uint32_t i = 0, seed = 12345; i < 200; i++) {
+
+            seed = seed * 1103515245 + 12345;
+            const uint32_t numerator = seed;
+            seed = seed * 1103515245 + 12345;
+            operands.push_back({numerator, seed >> (seed & 31)});
+        }
+
+        for (const auto &[numerator, denominator] : operands) {
+
+            QVERIFY((compare(UIDIV, {numerator, denominator, 0}, false)));
+            QVERIFY((compare(UIDIVMOD, {numerator, denominator, 0}, true)));
+            QVERIFY((compare(IDIV, {numerator, denominator, 0}, false)));
+            QVERIFY((compare(IDIVMOD, {numerator, denominator, 0}, true)));
+        }
+
+        // Alignements et tailles de memcpy, memset et strlen ; les deux mémoires partent des mêmes octets.
+        for (Vm *vm : {plain.get(), hooked.get()}) {
+
+            for (uint32_t i = 0; i < 256; i++) {
+                vm->getAddressZero()[BUFFER + i] = static_cast<std::byte>(i * 7 + 1);
+            }
+            vm->getAddressZero()[BUFFER + 200] = std::byte{0};
+            vm->markDirty(BUFFER, 256);
+        }
+
+        for (uint32_t destination = 0; destination < 4; destination++) {
+
+            for (uint32_t source = 0; source < 4; source++) {
+
+                for (uint32_t size : {0u, 1u, 3u, 4u, 7u, 15u, 16u, 17u, 33u, 64u}) {
+
+                    QVERIFY((compare(MEMCPY, {BUFFER + destination, BUFFER + 128 + source, size}, false)));
+                    QVERIFY((compare(MEMSET, {BUFFER + 64 + destination, 0x100 + size + source, size}, false)));
+                }
+            }
+
+            QVERIFY((compare(STRLEN, {BUFFER + 180 + destination, 0, 0}, false)));
+        }
+
+        // Ecriture de l'hôte hors des plages : faute signalée sur le swi de la routine, sans exception ni SIGSEGV
+        // perdu hors de run(). La VM reste utilisable.
+        if (memory != MemoryProperties::RAW) {
+
+            const CallResult faulted = hooked->call(MEMCPY, 0x02000000, BUFFER, 16);
+
+            QVERIFY(faulted.m_run.m_interrupt == Interrupt::Fatal && faulted.m_run.m_faulted);
+            QVERIFY(faulted.m_run.m_pc == MEMCPY);
+            QVERIFY(faulted.m_run.m_fault.m_address == 0x02000000);
+            QVERIFY(faulted.m_run.m_fault.m_access == AccessPermission::WRITE);
+            QVERIFY((compare(STRLEN, {BUFFER + 180, 0, 0}, false)));
+        }
+
+        std::filesystem::remove(elf);
+    }
+
+    // Virgule flottante logicielle de libgcc dans hello.bin, remplacée par l'hôte : chaque routine est appelée avec
+    // les mêmes arguments dans la VM remplacée et dans une VM sans remplacement, résultats comparés bit à bit (NaN,
+    // infinis, sous-normaux, zéros signés, arrondis, saturations). hello.bin n'a pas d'arithmétique simple précision,
+    // seulement ses comparaisons.
+    void testSoftFloat(const AluProperties::ExecutionMode mode   = AluProperties::INTERPRETER,
+                       const MemoryProperties::Type       memory = MemoryProperties::RAW) {
+
+        // Routines de hello.bin (libgcc, ieee754-df.S et ieee754-sf.S).
+        static constexpr uint32_t DRSUB  = 0x281ac;
+        static constexpr uint32_t DSUB   = 0x281b4;
+        static constexpr uint32_t DADD   = 0x281b8;
+        static constexpr uint32_t UI2D   = 0x284c8;
+        static constexpr uint32_t I2D    = 0x284ec;
+        static constexpr uint32_t F2D    = 0x28514;
+        static constexpr uint32_t UL2D   = 0x2855c;
+        static constexpr uint32_t L2D    = 0x28570;
+        static constexpr uint32_t DMUL   = 0x285d0;
+        static constexpr uint32_t DDIV   = 0x28860;
+        static constexpr uint32_t DCMPEQ = 0x28b38;
+        static constexpr uint32_t DCMPLT = 0x28b50;
+        static constexpr uint32_t DCMPLE = 0x28b68;
+        static constexpr uint32_t DCMPGE = 0x28b80;
+        static constexpr uint32_t DCMPGT = 0x28b98;
+        static constexpr uint32_t DCMPUN = 0x28bb0;
+        static constexpr uint32_t D2IZ   = 0x28be8;
+        static constexpr uint32_t D2UIZ  = 0x28c44;
+        static constexpr uint32_t D2F    = 0x28c98;
+        static constexpr uint32_t FCMPEQ = 0x28dd4;
+        static constexpr uint32_t FCMPLT = 0x28dec;
+        static constexpr uint32_t FCMPLE = 0x28e04;
+        static constexpr uint32_t FCMPGE = 0x28e1c;
+        static constexpr uint32_t FCMPGT = 0x28e34;
+        static constexpr uint32_t FCMPUN = 0x28e4c;
+
+        const std::vector<std::pair<HleRoutine, uint32_t>> arithmetic = {
+            {HleRoutine::Dadd, DADD}, {HleRoutine::Dsub, DSUB}, {HleRoutine::Drsub, DRSUB},
+            {HleRoutine::Dmul, DMUL}, {HleRoutine::Ddiv, DDIV}};
+        const std::vector<std::pair<HleRoutine, uint32_t>> doubles = {
+            {HleRoutine::Dcmpeq, DCMPEQ}, {HleRoutine::Dcmplt, DCMPLT}, {HleRoutine::Dcmple, DCMPLE},
+            {HleRoutine::Dcmpge, DCMPGE}, {HleRoutine::Dcmpgt, DCMPGT}, {HleRoutine::Dcmpun, DCMPUN}};
+        const std::vector<std::pair<HleRoutine, uint32_t>> floats = {
+            {HleRoutine::Fcmpeq, FCMPEQ}, {HleRoutine::Fcmplt, FCMPLT}, {HleRoutine::Fcmple, FCMPLE},
+            {HleRoutine::Fcmpge, FCMPGE}, {HleRoutine::Fcmpgt, FCMPGT}, {HleRoutine::Fcmpun, FCMPUN}};
+        const std::vector<std::pair<HleRoutine, uint32_t>> conversions = {
+            {HleRoutine::I2d, I2D}, {HleRoutine::Ui2d, UI2D}, {HleRoutine::L2d, L2D},   {HleRoutine::Ul2d, UL2D},
+            {HleRoutine::F2d, F2D}, {HleRoutine::D2f, D2F},   {HleRoutine::D2iz, D2IZ}, {HleRoutine::D2uiz, D2UIZ}};
+
+        const auto build = [&](const bool hooked) {
+
+            VmProperties vmProperties;
+            vmProperties.m_aluProperties.m_executionMode = mode;
+            vmProperties.m_bin = std::string(getBinPath()) + "/src/test_compile/hello.bin";
+
+            if (hooked) {
+
+                for (const auto &routines : {arithmetic, doubles, floats, conversions}) {
+
+                    for (const auto &[routine, address] : routines) {
+                        vmProperties.m_hle.push_back({routine, address});
+                    }
+                }
+            }
+
+            if (memory != MemoryProperties::RAW) {
+
+                // rom (code, data, bss), ram, stack, uart
+                vmProperties.m_memoryProperties.m_layout = {{0x00000000, 4_mb, AccessPermission::READ_WRITE},
+                                                            {0x00400000, 8_mb, AccessPermission::READ_WRITE},
+                                                            {0x00C00000, 4_mb, AccessPermission::READ_WRITE},
+                                                            {0x01000000, 1_mb, AccessPermission::READ_WRITE}};
+                vmProperties.m_memoryProperties.m_type   = memory;
+            } else {
+                vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+            }
+
+            std::unique_ptr<Vm> vm = Vm::build(vmProperties);
+            vm->reset();
+            vm->load();
+
+            // Code de démarrage : la pile est en place après Stop.
+            for (RunResult result = vm->run(0, std::nothrow); result.m_interrupt != Interrupt::Stop;
+                 result = vm->run(0, std::nothrow)) {
+            }
+
+            return vm;
+        };
+
+        std::unique_ptr<Vm> plain  = build(false);
+        std::unique_ptr<Vm> hooked = build(true);
+
+        // r1 n'est comparé que pour un résultat double : sinon il reste à l'appelé, comme r2, r3 et r12.
+        const auto compare = [&](const uint32_t address, const std::array<uint32_t, 4> &arguments,
+                                 const bool twoResults) {
+
+            const CallResult expected = plain->call(address, arguments[0], arguments[1], arguments[2], arguments[3]);
+            const CallResult result   = hooked->call(address, arguments[0], arguments[1], arguments[2], arguments[3]);
+
+            return expected.m_run.m_interrupt == Interrupt::Return && result.m_run.m_interrupt == Interrupt::Return &&
+                   result.m_run.m_instructions < expected.m_run.m_instructions && result.m_r0 == expected.m_r0 &&
+                   (!twoResults || result.m_r1 == expected.m_r1);
+        };
+
+        std::vector<uint64_t> values = {
+            0x0000000000000000, 0x8000000000000000, 0x0000000000000001, 0x8000000000000001, 0x000FFFFFFFFFFFFF,
+            0x0010000000000000, 0x8010000000000000, 0x3FF0000000000000, 0xBFF0000000000000, 0x3FF0000000000001,
+            0x3FF8000000000000, 0x4000000000000000, 0xC008000000000000, 0x3FB999999999999A, 0x3CA0000000000000,
+            0x41DFFFFFFFC00000, 0x41E0000000000000, 0xC1E0000000000000, 0xC1E0000000100000, 0x41EFFFFFFFE00000,
+            0x41F0000000000000, 0xBFE0000000000000, 0x7FEFFFFFFFFFFFFF, 0xFFEFFFFFFFFFFFFF, 0x7FF0000000000000,
+            0xFFF0000000000000, 0x7FF8000000000000, 0xFFF8000000000000, 0x7FF0000000000001, 0xFFF4000000001234,
+            0x47EFFFFFE0000000, 0x47EFFFFFF0000000, 0x3810000000000000, 0x380FFFFFF0000000, 0x36A0000000000000};
+
+        // Doubles pseudo-aléatoires : motifs quelconques, puis exposants proches pour les additions qui s'annulent.
+        for (uint32_t i = 0, seed = 54321; i < 20; i++) {
+
+            seed = seed * 1103515245 + 12345;
+            const uint64_t high = seed;
+            seed = seed * 1103515245 + 12345;
+            values.push_back(high << 32 | seed);
+            values.push_back((high & 0x800FFFFF) << 32 | uint64_t{0x3FF00000 + (i & 7) * 0x00100000} << 32 | seed);
+        }
+
+        for (const uint64_t x : values) {
+
+            for (const uint64_t y : values) {
+
+                const std::array<uint32_t, 4> arguments = {static_cast<uint32_t>(x), static_cast<uint32_t>(x >> 32),
+                                                           static_cast<uint32_t>(y), static_cast<uint32_t>(y >> 32)};
+
+                for (const auto &[routine, address] : arithmetic) {
+                    QVERIFY((compare(address, arguments, true)));
+                }
+
+                for (const auto &[routine, address] : doubles) {
+                    QVERIFY((compare(address, arguments, false)));
+                }
+            }
+
+            // Doubles vers float et entiers, entiers de 64 bits vers double.
+            const std::array<uint32_t, 4> argument = {static_cast<uint32_t>(x), static_cast<uint32_t>(x >> 32), 0, 0};
+
+            for (const uint32_t address : {D2F, D2IZ, D2UIZ}) {
+                QVERIFY((compare(address, argument, false)));
+            }
+
+            for (const uint32_t address : {L2D, UL2D}) {
+                QVERIFY((compare(address, argument, true)));
+            }
+        }
+
+        std::vector<uint32_t> words = {0x00000000, 0x80000000, 0x00000001, 0x807FFFFF, 0x00800000, 0x3F800000,
+                                       0xBF800000, 0x3FC00000, 0x7F7FFFFF, 0xFF7FFFFF, 0x7F800000, 0xFF800000,
+                                       0x7FC00000, 0xFFC00000, 0x7F800001, 0xFFA01234, 0x7FFFFFFF, 0x4EFFFFFF,
+                                       0x4F000000, 0xCF000000, 0x4F800000, 0xFFFFFFFF, 0x00000003, 0x0FFFFFFF};
+
+        for (uint32_t i = 0, seed = 6789; i < 24; i++) {
+
+            seed = seed * 1103515245 + 12345;
+            words.push_back(seed);
+        }
+
+        for (const uint32_t x : words) {
+
+            for (const uint32_t y : words) {
+
+                for (const auto &[routine, address] : floats) {
+                    QVERIFY((compare(address, {x, y, 0, 0}, false)));
+                }
+            }
+
+            // Float vers double, entiers de 32 bits vers double.
+            for (const uint32_t address : {F2D, I2D, UI2D}) {
+                QVERIFY((compare(address, {x, 0, 0, 0}, true)));
+            }
+        }
+    }
+
+  private:
+    struct ElfSegment {
+        uint32_t          m_address;
+        uint32_t          m_memorySize;
+        uint32_t          m_flags;
+        std::vector<char> m_data;
+    };
+
+    // ELF32 ARM minimal : en-tête, segments PT_LOAD, puis .symtab et .strtab.
+    static void writeElf(const std::string &path, const uint32_t entry, const std::vector<ElfSegment> &segments,
+                         const std::vector<std::pair<std::string, uint32_t>> &symbols) {
+
+        std::vector<char> out(52 + 32 * segments.size());
+
+        const auto put = [&out](const std::size_t offset, const auto value) {
+            std::memcpy(out.data() + offset, &value, sizeof(value));
+        };
+
+        std::memcpy(out.data(), "\x7F" "ELF\x01\x01\x01", 7);
+        put(16, uint16_t{2});  // ET_EXEC
+        put(18, uint16_t{40}); // EM_ARM
+        put(20, uint32_t{1});
+        put(24, entry);
+        put(28, uint32_t{52});
+        put(40, uint16_t{52});
+        put(42, uint16_t{32});
+        put(44, static_cast<uint16_t>(segments.size()));
+        put(46, uint16_t{40});
+
+        for (std::size_t i = 0; i < segments.size(); i++) {
+
+            const std::size_t header = 52 + 32 * i;
+
+            put(header, uint32_t{1}); // PT_LOAD
+            put(header + 4, static_cast<uint32_t>(out.size()));
+            put(header + 8, segments[i].m_address);
+            put(header + 12, segments[i].m_address);
+            put(header + 16, static_cast<uint32_t>(segments[i].m_data.size()));
+            put(header + 20, segments[i].m_memorySize);
+            put(header + 24, segments[i].m_flags);
+            out.insert(out.end(), segments[i].m_data.begin(), segments[i].m_data.end());
+            out.resize((out.size() + 3) & ~std::size_t{3});
+        }
+
+        std::vector<char> names(1, '\0');
+        std::vector<char> table(16, '\0');
+
+        for (const auto &[name, value] : symbols) {
+
+            std::vector<char> symbol(16, '\0');
+            const uint32_t    offset = static_cast<uint32_t>(names.size());
+            std::memcpy(symbol.data(), &offset, 4);
+            std::memcpy(symbol.data() + 4, &value, 4);
+            symbol[12] = 0x12; // STB_GLOBAL, STT_FUNC
+            symbol[14] = 1;
+            table.insert(table.end(), symbol.begin(), symbol.end());
+            names.insert(names.end(), name.begin(), name.end());
+            names.push_back('\0');
+        }
+
+        const uint32_t tableOffset = static_cast<uint32_t>(out.size());
+        out.insert(out.end(), table.begin(), table.end());
+        const uint32_t namesOffset = static_cast<uint32_t>(out.size());
+        out.insert(out.end(), names.begin(), names.end());
+        out.resize((out.size() + 3) & ~std::size_t{3});
+
+        // Sections : nulle, .symtab, .strtab.
+        const std::size_t sections = out.size();
+        put(32, static_cast<uint32_t>(sections));
+        put(48, uint16_t{3});
+        out.resize(sections + 3 * 40, '\0');
+        put(sections + 40 + 4, uint32_t{2}); // SHT_SYMTAB
+        put(sections + 40 + 16, tableOffset);
+        put(sections + 40 + 20, static_cast<uint32_t>(table.size()));
+        put(sections + 40 + 24, uint32_t{2});
+        put(sections + 40 + 36, uint32_t{16});
+        put(sections + 80 + 4, uint32_t{3}); // SHT_STRTAB
+        put(sections + 80 + 16, namesOffset);
+        put(sections + 80 + 20, static_cast<uint32_t>(names.size()));
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    }
 };
 
 
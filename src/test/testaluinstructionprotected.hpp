@@ -122,6 +122,16 @@ class TestAluInstructionProtected : public QObject {
     void testR15() { m_test.testR15(); }
     void testSWP_1() { m_test.testSWP_1(); }
     void testSWPB_1() { m_test.testSWPB_1(); }
+    void testPredecodeInvalidation() { m_test.testPredecodeInvalidation(); }
+    void testThreadedInvalidation() { m_test.testThreadedInvalidation(); }
+    void testBlockInvalidation() { m_test.testBlockInvalidation(); }
+    void testBlockRewrittenBranch() { m_test.testBlockRewrittenBranch(); }
+    void testSoftwareInterrupt() { m_test.testSoftwareInterrupt(); }
+    void testRunResult() { m_test.testRunResult(); }
+    void testRestore() { m_test.testRestore(); }
+    void testSharedPredecode() { m_test.testSharedPredecode(); }
+    void testJitInvalidation() { m_test.testJitInvalidation(); }
+    void testJitDataProcessing() { m_test.testJitDataProcessing(); }
 };
 
 } // namespace armv4vm
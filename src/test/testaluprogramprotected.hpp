@@ -23,6 +23,20 @@ class TestAluProgramProtected : public QObject {
     void testProgramPrintf() { m_test.testProgramPrintf(); }
     void testProgramModulo() {  m_test.testProgramModulo(); }
     void testProgramBench() { m_test.testProgramBench(); }
+    void testProgramFork() { m_test.testProgramFork(AluProperties::THREADED, MemoryProperties::PROTECTED); }
+    void testProgramElf() { m_test.testProgramElf(AluProperties::PREDECODED, MemoryProperties::PROTECTED); }
+    void testCall() { m_test.testCall(AluProperties::THREADED, MemoryProperties::PROTECTED); }
+    void testSwiHandlers() { m_test.testSwiHandlers(AluProperties::THREADED, MemoryProperties::PROTECTED); }
+    void testHle() { m_test.testHle(AluProperties::THREADED, MemoryProperties::PROTECTED); }
+    void testSoftFloat() { m_test.testSoftFloat(AluProperties::THREADED, MemoryProperties::PROTECTED); }
+#if ARMV4VM_GUARDED
+    void testProgramForkGuarded() { m_test.testProgramFork(AluProperties::INTERPRETER, MemoryProperties::GUARDED); }
+    void testProgramElfGuarded() { m_test.testProgramElf(AluProperties::INTERPRETER, MemoryProperties::GUARDED); }
+    void testCallGuarded() { m_test.testCall(AluProperties::PREDECODED, MemoryProperties::GUARDED); }
+    void testSwiHandlersGuarded() { m_test.testSwiHandlers(AluProperties::PREDECODED, MemoryProperties::GUARDED); }
+    void testHleGuarded() { m_test.testHle(AluProperties::PREDECODED, MemoryProperties::GUARDED); }
+    void testSoftFloatGuarded() { m_test.testSoftFloat(AluProperties::PREDECODED, MemoryProperties::GUARDED); }
+#endif
 };
 
 
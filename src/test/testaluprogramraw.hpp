@@ -23,6 +23,54 @@ class TestAluProgramRaw : public QObject {
     void testProgramPrintf() { m_test.testProgramPrintf(); }
     void testProgramModulo() {  m_test.testProgramModulo(); }
     void testProgramBench() { m_test.testProgramBench(); }
+
+    void testProgramHelloPredecoded() { m_test.testProgramHello(AluProperties::PREDECODED); }
+    void testProgramPrimeNPredecoded() { m_test.testProgramPrimeN(AluProperties::PREDECODED); }
+    void testProgramFloatPredecoded() { m_test.testProgramFloat(AluProperties::PREDECODED); }
+    void testProgramPrintfPredecoded() { m_test.testProgramPrintf(AluProperties::PREDECODED); }
+    void testProgramModuloPredecoded() { m_test.testProgramModulo(AluProperties::PREDECODED); }
+    void testProgramBenchPredecoded() { m_test.testProgramBench(AluProperties::PREDECODED); }
+
+    void testProgramHelloThreaded() { m_test.testProgramHello(AluProperties::THREADED); }
+    void testProgramPrimeNThreaded() { m_test.testProgramPrimeN(AluProperties::THREADED); }
+    void testProgramFloatThreaded() { m_test.testProgramFloat(AluProperties::THREADED); }
+    void testProgramPrintfThreaded() { m_test.testProgramPrintf(AluProperties::THREADED); }
+    void testProgramModuloThreaded() { m_test.testProgramModulo(AluProperties::THREADED); }
+    void testProgramBenchThreaded() { m_test.testProgramBench(AluProperties::THREADED); }
+
+    void testProgramHelloBlock() { m_test.testProgramHello(AluProperties::BLOCK); }
+    void testProgramPrimeNBlock() { m_test.testProgramPrimeN(AluProperties::BLOCK); }
+    void testProgramFloatBlock() { m_test.testProgramFloat(AluProperties::BLOCK); }
+    void testProgramPrintfBlock() { m_test.testProgramPrintf(AluProperties::BLOCK); }
+    void testProgramModuloBlock() { m_test.testProgramModulo(AluProperties::BLOCK); }
+    void testProgramBenchBlock() { m_test.testProgramBench(AluProperties::BLOCK); }
+
+    void testProgramHelloJit() { m_test.testProgramHello(AluProperties::JIT); }
+    void testProgramPrimeNJit() { m_test.testProgramPrimeN(AluProperties::JIT); }
+    void testProgramFloatJit() { m_test.testProgramFloat(AluProperties::JIT); }
+    void testProgramPrintfJit() { m_test.testProgramPrintf(AluProperties::JIT); }
+    void testProgramModuloJit() { m_test.testProgramModulo(AluProperties::JIT); }
+    void testProgramBenchJit() { m_test.testProgramBench(AluProperties::JIT); }
+
+    void testProgramConcurrent() { m_test.testProgramConcurrent(); }
+    void testProgramConcurrentJit() { m_test.testProgramConcurrent(AluProperties::JIT); }
+
+    void testProgramFork() { m_test.testProgramFork(); }
+    void testProgramForkJit() { m_test.testProgramFork(AluProperties::JIT); }
+    void testProgramElf() { m_test.testProgramElf(); }
+    void testProgramElfBlock() { m_test.testProgramElf(AluProperties::BLOCK); }
+    void testCall() { m_test.testCall(); }
+    void testCallBlock() { m_test.testCall(AluProperties::BLOCK); }
+    void testCallJit() { m_test.testCall(AluProperties::JIT); }
+    void testSwiHandlers() { m_test.testSwiHandlers(); }
+    void testSwiHandlersBlock() { m_test.testSwiHandlers(AluProperties::BLOCK); }
+    void testSwiHandlersJit() { m_test.testSwiHandlers(AluProperties::JIT); }
+    void testHle() { m_test.testHle(); }
+    void testHleBlock() { m_test.testHle(AluProperties::BLOCK); }
+    void testHleJit() { m_test.testHle(AluProperties::JIT); }
+    void testSoftFloat() { m_test.testSoftFloat(); }
+    void testSoftFloatBlock() { m_test.testSoftFloat(AluProperties::BLOCK); }
+    void testSoftFloatJit() { m_test.testSoftFloat(AluProperties::JIT); }
 };
 
 } // namespace armv4vm
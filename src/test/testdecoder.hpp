@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+#include "decoder.hpp"
+
+namespace armv4vm {
+
+class TestDecoder : public QObject {
+    Q_OBJECT
+  public:
+    TestDecoder() {}
+
+  private slots:
+
+    // La table doit donner le même format que la chaîne de masques pour chacun des 4096 index,
+    // quels que soient les bits hors index (cond, [19:8], [3:0]).
+    void testDecodeTableMatchesMaskChain() {
+
+        static constexpr uint32_t OUTSIDE_INDEX = 0xF00FFF0F;
+        const uint32_t fillers[] = {0x00000000, 0xFFFFFFFF, 0x000FFF00, 0x00000F00, 0x00000100,
+                                    0x000FF000, 0xE0000000, 0xE00FFF0F, 0x0000000F, 0xA5A5A5A5};
+
+        uint32_t random = 0x12345678;
+
+        for (uint32_t index = 0; index < 4096; index++) {
+
+            const uint32_t instruction = ((index & 0xFF0) << 16) | ((index & 0x00F) << 4);
+            QVERIFY(decoder::tableIndex(instruction) == index);
+
+            for (const uint32_t filler : fillers) {
+
+                const uint32_t probe = instruction | (filler & OUTSIDE_INDEX);
+                QVERIFY(decoder::decode(probe) == decoder::decodeMaskChain(probe));
+            }
+
+            for (int i = 0; i < 16; i++) {
+
+                random = random * 1664525 + 1013904223;
+
+                const uint32_t probe = instruction | (random & OUTSIDE_INDEX);
+                QVERIFY(decoder::decode(probe) == decoder::decodeMaskChain(probe));
+            }
+
+            // Une entrée résolue dans la table ne dépend pas des bits hors index.
+            const FormatSummary entry = decoder::DECODE_TABLE[index];
+            if (entry != unknown) {
+                QVERIFY(entry == decoder::decodeMaskChain(instruction));
+            }
+        }
+    }
+
+    // bx, swp et ldrh/strh à offset registre se distinguent par des bits hors index.
+    void testDecodeTableRefinement() {
+
+        QVERIFY(decoder::decode(0xE12FFF1E) == branch_and_exchange);              // bx lr
+        QVERIFY(decoder::decode(0xE1A0F00E) == data_processing);                  // mov pc, lr
+        QVERIFY(decoder::decode(0xE1010092) == single_data_swap);                 // swp r0, r2, [r1]
+        QVERIFY(decoder::decode(0xE19100B2) == halfword_data_transfer_register_off); // ldrh r0, [r1, r2]
+        QVERIFY(decoder::decode(0xE1D100B2) == halfword_data_transfer_immediate_off); // ldrh r0, [r1, #2]
+        QVERIFY(decoder::decode(0xE0010392) == multiply);                         // mul r1, r2, r3
+        QVERIFY(decoder::decode(0xE0810392) == multiply_long);                    // umull r0, r1, r2, r3
+        QVERIFY(decoder::decode(0xEF000000) == software_interrupt);               // swi 0
+        QVERIFY(decoder::decode(0xE7F000F0) == undefined);
+    }
+
+    // § 4.2 : une ligne par condition (EQ..NV), bit n vrai si la condition passe quand NZCV vaut n.
+    void testConditionTable() {
+
+        static constexpr std::array<uint16_t, 16> EXPECTED = {0xF0F0, 0x0F0F, 0xCCCC, 0x3333, 0xFF00, 0x00FF,
+                                                              0xAAAA, 0x5555, 0x0C0C, 0xF3F3, 0xAA55, 0x55AA,
+                                                              0x0A05, 0xF5FA, 0xFFFF, 0x0000};
+
+        QVERIFY(decoder::CONDITION_TABLE == EXPECTED);
+    }
+};
+
+} // namespace armv4vm
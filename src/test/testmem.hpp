@@ -3,6 +3,8 @@
 #include <QObject>
 #include <QTest>
 #include <cstddef>
+#include <filesystem>
+#include <fstream>
 
 #include "armv4vm.hpp"
 
@@ -662,6 +664,403 @@ class TestMem : public QObject {
         QVERIFY(exceptionRaised == false);
     }
 
+    // Plages espacées : la mémoire est indexée par adresse, le trou n'est ni accessible ni alloué.
+    void testProtectedGaps() {
+
+        MemoryProperties properties;
+        properties.m_layout.push_back({0, 64, AccessPermission::READ_WRITE});
+        properties.m_layout.push_back({0x00100000, 64, AccessPermission::READ_WRITE});
+
+        MemoryProtected pro(properties);
+        std::byte      *mem             = pro.reset(std::byte{0x5A});
+        bool            exceptionRaised = false;
+
+        QVERIFY(pro.size() == 0x00100040);
+        QVERIFY(mem[0x00100000 + 63] == std::byte{0x5A});
+
+        pro.writePointer<uint32_t>(0x00100000 + 60) = 0x11223344;
+        QVERIFY(read<uint32_t>(mem, 0x00100000 + 60) == 0x11223344);
+        QVERIFY(pro.readPointer<uint32_t>(0x00100000 + 60) == 0x11223344);
+
+        try {
+            pro.writePointer<uint32_t>(0x1000) = 0;
+        } catch (std::exception &) {
+            exceptionRaised = true;
+        }
+        QVERIFY(exceptionRaised);
+
+        pro.reset();
+        QVERIFY(read<uint32_t>(mem, 0x00100000 + 60) == 0);
+    }
+
+#if defined(__unix__)
+    // Seules les pages touchées occupent de la mémoire ; reset() les rend au système.
+    void testResidentPages() {
+
+        static constexpr std::size_t PAGE = 4096;
+
+        MemoryProperties properties;
+        properties.m_memorySizeBytes = 16_mb;
+
+        MemoryRaw  raw(properties);
+        std::byte *mem = raw.reset();
+
+        const auto resident = [mem]() {
+
+            std::vector<unsigned char> pages(16_mb / PAGE);
+            mincore(mem, 16_mb, pages.data());
+            return std::count_if(pages.begin(), pages.end(), [](const unsigned char page) { return page & 1; });
+        };
+
+        QVERIFY(resident() == 0);
+
+        raw.writePointer<uint32_t>(0x00000010) = 1;
+        raw.writePointer<uint32_t>(0x00F00000) = 2;
+        QVERIFY(resident() == 2);
+        QVERIFY(raw.readPointer<uint32_t>(0x00F00000) == 2);
+
+        raw.reset();
+        QVERIFY(resident() == 0);
+        QVERIFY(raw.readPointer<uint32_t>(0x00F00000) == 0);
+    }
+#endif
+
+    // Seules les pages écrites depuis l'instantané sont recopiées, y compris la dernière page incomplète.
+    void testRestorePages() {
+
+        MemoryProperties properties;
+        properties.m_layout.push_back({0, 0x00100000, AccessPermission::READ_WRITE});
+        properties.m_layout.push_back({0x00200000, 0x100, AccessPermission::READ_WRITE});
+
+        MemoryProtected       pro(properties);
+        std::byte            *mem = pro.reset();
+        std::vector<uint32_t> restored;
+
+        pro.writePointer<uint32_t>(0x00001000) = 0x11111111;
+        pro.writePointer<uint32_t>(0x002000FC) = 0x22222222;
+        pro.capture();
+
+        pro.writePointer<uint32_t>(0x00001000) = 0x33333333;
+        pro.writePointer<uint32_t>(0x00003FFE, 0x44444444);
+        pro.writePointer<uint32_t>(0x002000FC) = 0x55555555;
+
+        // Écriture de l'hôte non signalée : hors instantané.
+        write<uint32_t>(mem, 0x00080000, 0x66666666);
+
+        pro.restore([&restored](const uint32_t address) { restored.push_back(address); });
+
+        QVERIFY((restored == std::vector<uint32_t>{0x00001000, 0x00003000, 0x00004000, 0x00200000}));
+        QVERIFY(pro.readPointer<uint32_t>(0x00001000) == 0x11111111);
+        QVERIFY(pro.readPointer<uint32_t>(0x00003FFC) == 0);
+        QVERIFY(pro.readPointer<uint32_t>(0x00004000) == 0);
+        QVERIFY(pro.readPointer<uint32_t>(0x002000FC) == 0x22222222);
+        QVERIFY(read<uint32_t>(mem, 0x00080000) == 0x66666666);
+
+        pro.markDirty(0x00080000, 4);
+        restored.clear();
+        pro.restore([&restored](const uint32_t address) { restored.push_back(address); });
+
+        QVERIFY((restored == std::vector<uint32_t>{0x00080000}));
+        QVERIFY(read<uint32_t>(mem, 0x00080000) == 0);
+    }
+
+    // Une mémoire issue d'une image en a le contenu, n'écrit jamais dans l'image, y revient par restore() et repart de
+    // zéros après reset().
+    void testMemoryImage() {
+
+        MemoryProperties properties;
+        properties.m_memorySizeBytes = 1_mb;
+
+        MemoryRaw origin(properties);
+        origin.reset();
+        origin.writePointer<uint32_t>(0x00001000) = 0x11111111;
+        origin.writePointer<uint32_t>(0x00080000) = 0x22222222;
+
+        const std::shared_ptr<const MemoryImage> image = origin.image();
+
+        QVERIFY((image->pages() == std::vector<uint32_t>{0x1, 0x80}));
+
+        MemoryRaw fork(properties, image);
+
+        QVERIFY(fork.readPointer<uint32_t>(0x00001000) == 0x11111111);
+        QVERIFY(fork.readPointer<uint32_t>(0x00080000) == 0x22222222);
+
+        fork.writePointer<uint32_t>(0x00001000) = 0x33333333;
+        fork.writePointer<uint32_t>(0x00002000) = 0x44444444;
+        QVERIFY(read<uint32_t>(const_cast<std::byte *>(image->data()), 0x00001000) == 0x11111111);
+        QVERIFY(origin.readPointer<uint32_t>(0x00001000) == 0x11111111);
+
+        fork.restore([](uint32_t) {});
+        QVERIFY(fork.readPointer<uint32_t>(0x00001000) == 0x11111111);
+        QVERIFY(fork.readPointer<uint32_t>(0x00002000) == 0);
+
+        fork.reset();
+        QVERIFY(fork.readPointer<uint32_t>(0x00001000) == 0);
+        QVERIFY(fork.readPointer<uint32_t>(0x00080000) == 0);
+        QVERIFY(read<uint32_t>(const_cast<std::byte *>(image->data()), 0x00080000) == 0x22222222);
+    }
+
+    // Un programme n'est lu qu'une fois tant que le fichier ne change pas ; la mémoire qui le charge en a le contenu,
+    // y revient par restore() et laisse l'image intacte.
+    void testProgramCache() {
+
+        const std::string path = (std::filesystem::temp_directory_path() / "armv4vm_testprogramcache.bin").string();
+        const auto        save = [&path](const std::vector<uint32_t> &words) {
+
+            std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(words.data()), static_cast<std::streamsize>(words.size() * 4));
+        };
+
+        save({0x11111111, 0x22222222});
+
+        const std::shared_ptr<const Program> program = ProgramCache::load(path);
+
+        QVERIFY(program != nullptr);
+        QVERIFY(program->m_image->size() == 8);
+        QVERIFY(ProgramCache::load(path) == program);
+        QVERIFY(ProgramCache::load(path + ".absent") == nullptr);
+
+        MemoryProperties properties;
+        properties.m_memorySizeBytes = 1_mb;
+
+        MemoryRaw raw(properties);
+        raw.reset(std::byte{0xFF});
+        raw.load(program->m_image);
+
+        QVERIFY(raw.readPointer<uint32_t>(0x00000004) == 0x22222222);
+        QVERIFY(raw.readPointer<uint32_t>(0x00000008) == 0);
+        QVERIFY(raw.readPointer<uint32_t>(0x00001000) == 0xFFFFFFFF);
+
+        raw.writePointer<uint32_t>(0x00000000) = 0x33333333;
+        raw.restore([](uint32_t) {});
+        QVERIFY(raw.readPointer<uint32_t>(0x00000000) == 0x11111111);
+        QVERIFY(read<uint32_t>(const_cast<std::byte *>(program->m_image->data()), 0) == 0x11111111);
+
+        // Taille modifiée : le fichier est relu.
+        save({0x44444444, 0x55555555, 0x66666666});
+
+        const std::shared_ptr<const Program> reloaded = ProgramCache::load(path);
+
+        QVERIFY(reloaded != program);
+        QVERIFY(reloaded->m_image->size() == 12);
+        QVERIFY(read<uint32_t>(const_cast<std::byte *>(program->m_image->data()), 0) == 0x11111111);
+
+        ProgramCache::clear();
+        std::filesystem::remove(path);
+    }
+
+    // La table des pages doit rendre exactement le verdict du parcours des plages,
+    // plages alignées ou non, chevauchantes, ajoutées après coup.
+    void testPageTable() {
+
+        uint32_t random = 0x13579BDF;
+
+        const auto next = [&random](const uint32_t bound) {
+
+            random = random * 1664525 + 1013904223;
+            return (random >> 8) % bound;
+        };
+
+        for (int round = 0; round < 50; round++) {
+
+            MemoryProperties properties;
+            properties.m_pageBits = 4 + next(5);
+
+            const uint32_t pageSize = 1u << properties.m_pageBits;
+
+            for (uint32_t i = 0, count = 1 + next(6); i < count; i++) {
+
+                // Une plage sur deux alignée sur les pages.
+                const uint32_t start = i & 1 ? next(64) * pageSize : next(4096);
+                const uint32_t size  = i & 1 ? (1 + next(4)) * pageSize : 1 + next(512);
+
+                properties.m_layout.push_back({start, size, static_cast<AccessPermission>(next(4))});
+            }
+
+            MemoryProtected pro(properties);
+
+            pro.addAccessRangeImpl({next(4096), 1 + next(256), AccessPermission::READ});
+
+            for (int i = 0; i < 2000; i++) {
+
+                const uint32_t         address    = next(5000);
+                const std::size_t      dataSize   = std::size_t{1} << next(3);
+                const AccessPermission permission = next(2) ? AccessPermission::READ : AccessPermission::WRITE;
+
+                QVERIFY(pro.allowed(address, dataSize, permission) == pro.scan(address, dataSize, permission));
+            }
+        }
+    }
+
+    // Toute adresse est repliée sur l'espace ; le débordement d'un accès en fin d'espace reste dans la queue de garde,
+    // remise à zéro par reset() et restore().
+    void testMaskedMemory() {
+
+        MemoryProperties    properties;
+        MemoryMasked<12>    mem(properties);
+        std::byte          *data = mem.reset();
+
+        QVERIFY(mem.size() == 4_kb);
+
+        mem.writePointer<uint32_t>(0x10, 0x11223344);
+        QVERIFY(mem.readPointer<uint32_t>(0xFFFFF010) == 0x11223344);
+        QVERIFY(mem.readPointer<uint8_t>(0x1013) == 0x11);
+
+        mem.writePointer<uint32_t>(0x3FFE) = 0xAABBCCDD;
+        QVERIFY(mem.readPointer<uint16_t>(0xFFE) == 0xCCDD);
+        QVERIFY(mem.readPointer<uint16_t>(0) == 0);
+        QVERIFY(data[4_kb] == std::byte{0xBB});
+
+        mem.capture();
+        mem.writePointer<uint32_t>(0xFFE, 0x12345678);
+        mem.restore([](uint32_t) {});
+        QVERIFY(mem.readPointer<uint16_t>(0xFFE) == 0xCCDD);
+        QVERIFY(mem.readPointer<uint32_t>(0xFFE) == 0xCCDD);
+
+        // La taille demandée est arrondie à une taille instanciée.
+        VmProperties vmProperties;
+        vmProperties.m_memoryProperties.m_type            = MemoryProperties::MASKED;
+        vmProperties.m_memoryProperties.m_memorySizeBytes = 20_mb;
+
+        std::unique_ptr<Vm> vm = Vm::build(vmProperties);
+        vm->reset();
+        QVERIFY(vm->snapshot()->m_memory->size() == 32_mb);
+
+        vmProperties.m_memoryProperties.m_memorySizeBytes = 64_mb;
+
+        bool caught = false;
+        try {
+            Vm::build(vmProperties);
+        } catch (const VmException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+    }
+
+    // La référence de writePointer() écrit sans second contrôle, mais l'écriture accordée n'ouvre pas la lecture.
+    void testSingleCheck() {
+
+        MemoryProperties properties;
+        properties.m_layout.push_back({0, 32, AccessPermission::READ_WRITE});
+        properties.m_layout.push_back({32, 32, AccessPermission::WRITE});
+
+        MemoryProtected pro(properties);
+        std::byte      *mem = pro.reset();
+
+        pro.writePointer<uint32_t>(4) = 0x11223344;
+        pro.writePointer<uint16_t>(40) = 0x5566;
+        QVERIFY(pro.readPointer<uint32_t>(4) == 0x11223344);
+        QVERIFY(mem[40] == 0x66 && mem[41] == 0x55);
+
+        bool caught = false;
+        try {
+            MemoryRefSafe<uint32_t> ref = pro.writePointer<uint32_t>(36);
+            const uint32_t          value = ref;
+            QVERIFY(value == 0);
+        } catch (const MemoryFaultException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+
+        caught = false;
+        try {
+            pro.writePointer<uint32_t>(62) = 0;
+        } catch (const MemoryFaultException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+    }
+
+    // Un périphérique masque la RAM qu'il recouvre : ses registres passent par les callbacks, avec un décalage relatif
+    // à son début, et le reste de la page reste de la RAM ordinaire.
+    void testDevices() {
+
+        MemoryProperties      properties;
+        std::vector<uint32_t> writes;
+        uint32_t              reads = 0;
+
+        properties.m_layout.push_back({0, 0x2000, AccessPermission::READ_WRITE});
+        properties.m_devices.push_back({0x1010, 8,
+                                        [&reads](const uint32_t offset, const uint32_t size) {
+                                            reads++;
+                                            return 0xA0B0C000 | (offset << 4) | size;
+                                        },
+                                        [&writes](const uint32_t offset, const uint32_t size, const uint32_t value) {
+                                            writes.insert(writes.end(), {offset, size, value});
+                                        }});
+        properties.m_devices.push_back({0x1100, 4, nullptr, nullptr});
+
+        MemoryProtected pro(properties);
+
+        QVERIFY(pro.readPointer<uint32_t>(0x1010) == 0xA0B0C004);
+        QVERIFY(pro.readPointer<uint16_t>(0x1014) == 0xC042);
+        QVERIFY(pro.readPointer<uint8_t>(0x1017) == 0x71);
+        QVERIFY(reads == 3);
+
+        pro.writePointer<uint32_t>(0x1014, 0x12345678);
+        pro.writePointer<uint8_t>(0x1011, 0xFF);
+        QVERIFY((writes == std::vector<uint32_t>{4, 4, 0x12345678, 1, 1, 0xFF}));
+
+        // Par référence, comme l'ALU pour ses écritures.
+        pro.writePointer<uint16_t>(0x1012) = 0xBEEF;
+        QVERIFY(writes.size() == 9 && writes[8] == 0xBEEF);
+
+        // Les mots voisins, sur la même page, restent de la RAM.
+        pro.writePointer<uint32_t>(0x100C, 0xCAFEBABE);
+        pro.writePointer<uint32_t>(0x1018, 0xDEADBEEF);
+        QVERIFY(pro.readPointer<uint32_t>(0x100C) == 0xCAFEBABE);
+        QVERIFY(pro.readPointer<uint32_t>(0x1018) == 0xDEADBEEF);
+        QVERIFY(pro.readPointer<uint32_t>(0x0FF0) == 0);
+        QVERIFY(reads == 3 && writes.size() == 9);
+
+        // À cheval sur la limite du périphérique, sans callback ou plus large qu'un mot : faute.
+        bool caught = false;
+        try {
+            pro.readPointer<uint32_t>(0x100E);
+        } catch (const MemoryFaultException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+
+        caught = false;
+        try {
+            pro.writePointer<uint32_t>(0x1016, 0);
+        } catch (const MemoryFaultException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+
+        caught = false;
+        try {
+            pro.readPointer<uint32_t>(0x1100);
+        } catch (const MemoryFaultException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+
+        caught = false;
+        try {
+            pro.readPointer<uint64_t>(0x1010);
+        } catch (const MemoryFaultException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+        QVERIFY(reads == 3 && writes.size() == 9);
+
+        // Seule la mémoire protégée sait les desservir.
+        VmProperties vmProperties;
+        vmProperties.m_memoryProperties.m_memorySizeBytes = 0x2000;
+        vmProperties.m_memoryProperties.m_devices         = properties.m_devices;
+
+        caught = false;
+        try {
+            Vm::build(vmProperties);
+        } catch (const VmException &) {
+            caught = true;
+        }
+        QVERIFY(caught);
+    }
+
 };
 
 } // namespace armv4vm
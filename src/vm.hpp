@@ -17,13 +17,23 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
 #include <memory>
-#include <fstream>
+#include <new>
+#include <span>
+#include <type_traits>
 
 #include "armv4vm_p.hpp"
 #include "properties.hpp"
 #include "nullcopro.hpp"
 #include "alu.hpp"
+#include "hle.hpp"
+#include "memoryguarded.hpp"
+#include "memorymasked.hpp"
+#include "programcache.hpp"
 
 namespace armv4vm {
 
@@ -65,25 +75,90 @@ class VmException : public std::exception {
 };
 
 
+// État complet d'une VM à un instant donné, figé : Vm::fork() en crée autant de VM que voulu.
+struct VmSnapshot {
+    struct VmProperties                m_properties;
+    AluState                     m_state;
+    std::shared_ptr<const MemoryImage> m_memory;
+    std::shared_ptr<const Program>     m_program; // celui du load() dont la VM est partie
+};
+
 class Vm {
   protected:
     Vm() = default;
 
+    // Mot où call() peut poser son trampoline : aligné, dans une plage lisible et inscriptible, hors périphérique.
+    static bool fitsTrampoline(const MemoryProperties &memory, const uint32_t address) {
+
+        const auto covers = [address](const MemoryLayout &range) {
+            return range.permission == AccessPermission::READ_WRITE && address >= range.start &&
+                   uint64_t{address} + sizeof(uint32_t) <= uint64_t{range.start} + range.size;
+        };
+
+        const auto touches = [address](const MemoryDevice &device) {
+            return uint64_t{address} + sizeof(uint32_t) > device.start &&
+                   address < uint64_t{device.start} + device.size;
+        };
+
+        return address % sizeof(uint32_t) == 0 && std::ranges::any_of(memory.m_layout, covers) &&
+               std::ranges::none_of(memory.m_devices, touches);
+    }
+
   public:
 
     virtual ~Vm() = default;
 
     //virtual void init(struct VmProperties &vmProperties) = 0;
     virtual std::byte* reset() = 0;
+    // Adresse 0 de la mémoire invitée, celle que rend reset().
+    virtual std::byte* getAddressZero() = 0;
+    // Registres de l'ALU, r15 désignant l'instruction suivante. Lus et écrits hors de run() ou depuis un gestionnaire
+    // de swi (VmProperties::m_swiHandlers).
+    virtual std::array<uint32_t, 16> &registers() = 0;
+    // m_bin est un binaire brut chargé à l'adresse 0 ou un exécutable ELF32 ARM (segments PT_LOAD, e_entry).
     virtual uint64_t load() = 0;
+    // Programme du dernier load(), avec ses symboles quand c'est un ELF ; nullptr avant.
+    virtual std::shared_ptr<const Program> program() const = 0;
+    // Ramène la VM à la fin du dernier load() sans réallouer : registres à zéro, seules les pages écrites depuis sont
+    // recopiées. Les écritures de l'hôte par le pointeur de reset() doivent être signalées par markDirty().
+    virtual std::byte* restore() = 0;
+    virtual void markDirty(const uint32_t address, const std::size_t size) = 0;
+    // Registres et mémoire, hors de run(). Seules les pages non nulles sont recopiées ; comme pour restore(), les
+    // écritures de l'hôte par le pointeur de reset() n'en font partie que signalées par markDirty().
+    virtual std::shared_ptr<const VmSnapshot> snapshot() const = 0;
     virtual Interrupt run(const uint32_t nbMaxIteration = 0) = 0;
+    // Comme run(), mais une faute mémoire termine l'exécution sur Interrupt::Fatal au lieu de lever une exception.
+    virtual RunResult run(const uint32_t nbMaxIteration, std::nothrow_t) = 0;
+
+    // Appelle la fonction invitée à address selon l'AAPCS : quatre premiers arguments dans r0-r3, les suivants sur la
+    // pile courante, LR sur un trampoline (VmProperties::m_trampoline). L'exécution va jusqu'au retour, puis les
+    // registres reviennent à leur état d'avant l'appel. La pile doit être prête (code de démarrage déjà exécuté). Un
+    // trampoline ou un argument empilé refusé par la mémoire rend une faute dans CallResult, sans rien exécuter.
+    template <typename... Args>
+    CallResult call(const uint32_t address, const Args... arguments) {
+
+        static_assert((std::is_convertible_v<Args, uint32_t> && ...), "Vm::call : arguments de 32 bits");
+
+        const std::array<uint32_t, sizeof...(Args)> values = {static_cast<uint32_t>(arguments)...};
+        return call(address, std::span<const uint32_t>(values));
+    }
+    virtual CallResult call(const uint32_t address, std::span<const uint32_t> arguments) = 0;
+    // Reprend un appel suspendu par un swi autre que Interrupt::Resume (Suspend pour l'UART, etc.).
+    virtual CallResult resumeCall() = 0;
+
     static std::unique_ptr<Vm> build(const struct VmProperties &vmProperties);
+    // Nouvelle VM prête à reprendre là où snapshot a été pris, sans reset() ni load(). Sous Linux, ses pages sont
+    // celles de l'instantané, copiées à leur première écriture (sauf MemoryGuarded). restore() y ramène.
+    static std::unique_ptr<Vm> fork(const std::shared_ptr<const VmSnapshot> &snapshot);
+
+  private:
+    virtual void resume(const std::shared_ptr<const VmSnapshot> &snapshot) = 0;
 };
 
-template <typename MemoryHandler, typename CoproHandler>
+template <typename MemoryHandler, typename CoproHandler, Dispatch DispatchMode = Dispatch::SWITCH>
 class VmImplementation final : public Vm {
   private:
-    using PrivateAlu = Alu<MemoryHandler, CoproHandler>;
+    using PrivateAlu = Alu<MemoryHandler, CoproHandler, DispatchMode>;
     using PrivateVfpv2 = NullCopro<MemoryHandler>;
 
     VmImplementation(const struct VmProperties &vmProperties) {
@@ -109,37 +184,70 @@ class VmImplementation final : public Vm {
     std::byte* reset() {
 
         m_mem = std::make_unique<MemoryHandler>(m_vmProperties.m_memoryProperties);
-        m_alu = std::make_unique<PrivateAlu>(m_vmProperties.m_aluProperties);
-        m_vfp = std::make_unique<PrivateVfpv2>(m_vmProperties.m_coproProperties);
-
-        m_alu->attach(m_mem.get());
-        m_alu->attach(m_vfp.get());
-        m_vfp->attach(m_mem.get());
-        m_vfp->attach(m_alu.get());
+        attach();
+        m_origin     = AluState();
+        m_program    = nullptr;
+        m_trampoline = trampoline();
         return m_alu->reset();
     }
 
+    std::byte* getAddressZero() {
+
+        return m_mem->getAddressZero();
+    }
+
+    std::array<uint32_t, 16> &registers() {
+
+        return m_alu->getRegisters();
+    }
+
+    // Le programme (binaire brut ou ELF) est lu une fois par processus (ProgramCache), puis projeté à l'adresse 0 ;
+    // l'exécution part de son point d'entrée. Échoue si un segment dépasse la mémoire.
     uint64_t load() {
 
-        std::fstream program;
-        std::streampos programSize = 0;
+        std::shared_ptr<const Program> program = ProgramCache::load(m_vmProperties.m_bin);
 
-        program.open(m_vmProperties.m_bin, std::ios::in | std::ios::binary | std::ios::ate);
-        if (program.is_open()) {
+        if (!program || program->m_image->size() > m_mem->size()) {
 
-            programSize = program.tellg();
-            program.seekg(0, std::ios::beg);
+            m_error = E_LOAD_FAILED;
+            return false;
+        }
 
-                   //program.read((char *)(uint8_t *)m_mem, programSize);
-            program.read((char*) m_mem->getAddressZero(), programSize);
-            program.close();
-        } else {
+        m_mem->load(program->m_image);
+        m_origin                 = AluState();
+        m_origin.m_registers[15] = program->m_entry;
+        m_program                = std::move(program);
 
-            m_error     = E_LOAD_FAILED;
-            programSize = -1;
+        if (!hook(true)) {
+
+            m_error = E_LOAD_FAILED;
+            return false;
         }
 
-        return programSize > 0;
+        m_alu->resume(m_origin);
+
+        return m_program->m_image->size() > 0;
+    }
+
+    std::shared_ptr<const Program> program() const {
+
+        return m_program;
+    }
+
+    std::byte* restore() {
+
+        return m_alu->restore(m_origin);
+    }
+
+    void markDirty(const uint32_t address, const std::size_t size) {
+
+        m_mem->markDirty(address, size);
+    }
+
+    std::shared_ptr<const VmSnapshot> snapshot() const {
+
+        return std::make_shared<const VmSnapshot>(VmSnapshot{
+            m_vmProperties, m_alu->getState(), m_mem->image(), m_program});
     }
 
     inline Interrupt run(const uint32_t nbMaxIteration = 0) {
@@ -147,13 +255,227 @@ class VmImplementation final : public Vm {
         return m_alu->run(nbMaxIteration);
     }
 
+    inline RunResult run(const uint32_t nbMaxIteration, std::nothrow_t) {
+
+        return m_alu->run(nbMaxIteration, std::nothrow);
+    }
+
+    using Vm::call;
+
+    CallResult call(const uint32_t address, std::span<const uint32_t> arguments) {
+
+        std::array<uint32_t, 16> &registers = m_alu->getRegisters();
+
+        // Au-delà de r0-r3, les arguments sont empilés ; la pile reste alignée sur 8 octets à l'appel.
+        const std::size_t stacked = arguments.size() > 4 ? arguments.size() - 4 : 0;
+        const uint32_t    sp      = static_cast<uint32_t>(registers[13] - stacked * 4) & ~7u;
+
+        // Ecritures de l'hôte par l'ALU, comme celles d'une routine HLE : permissions, puis invalidation du seul mot
+        // de code touché. Une faute est rendue dans CallResult, registres inchangés.
+        try {
+
+            // Le trampoline n'est écrit qu'au premier appel, ou si l'invité l'a écrasé.
+            if (m_alu->template load<uint32_t>(m_trampoline) != RETURN_INSTRUCTION) [[unlikely]] {
+                m_alu->template store<uint32_t>(m_trampoline, RETURN_INSTRUCTION);
+            }
+
+            for (std::size_t i = 0; i < stacked; i++) {
+                m_alu->template store<uint32_t>(static_cast<uint32_t>(sp + i * 4), arguments[4 + i]);
+            }
+        } catch (const MemoryFaultException &exception) {
+
+            CallResult result;
+            result.m_run = RunResult{Interrupt::Fatal, 0, registers[15], true, exception.fault()};
+            return result;
+        }
+
+        m_caller = m_alu->getState();
+
+        std::copy_n(arguments.begin(), std::min<std::size_t>(arguments.size(), 4), registers.begin());
+        registers[13] = sp;
+        registers[14] = m_trampoline;
+        registers[15] = address;
+
+        return resumeCall();
+    }
+
+    CallResult resumeCall() {
+
+        CallResult result;
+
+        do {
+            result.m_run = m_alu->run(0, std::nothrow);
+        } while (result.m_run.m_interrupt == Interrupt::Resume);
+
+        if (result.m_run.m_interrupt == Interrupt::Return) {
+
+            std::array<uint32_t, 16> &registers = m_alu->getRegisters();
+
+            result.m_r0 = registers[0];
+            result.m_r1 = registers[1];
+            registers   = m_caller.m_registers;
+            m_alu->setCPSR(m_caller.m_cpsr);
+        }
+
+        return result;
+    }
+
   private:
 
+    void resume(const std::shared_ptr<const VmSnapshot> &snapshot) {
+
+        m_mem = std::make_unique<MemoryHandler>(m_vmProperties.m_memoryProperties, snapshot->m_memory);
+        attach();
+        m_origin     = snapshot->m_state;
+        m_program    = snapshot->m_program;
+        m_trampoline = trampoline();
+        // Les routines remplacées le sont déjà dans l'image de l'instantané.
+        hook(false);
+        m_alu->resume(m_origin);
+    }
+
+    // VmProperties::m_trampoline, vérifié par Vm::build. Par défaut, le dernier mot de la mémoire ou, avec un layout,
+    // le plus haut mot où fitsTrampoline() accepte de le poser. Sans un tel mot, le dernier mot de la mémoire reste
+    // la seule proposition et call() y rencontre la faute.
+    uint32_t trampoline() const {
+
+        const MemoryProperties &memory = m_vmProperties.m_memoryProperties;
+        const auto              last   = static_cast<uint32_t>(m_mem->size() - sizeof(uint32_t));
+
+        if (m_vmProperties.m_trampoline || memory.m_layout.empty()) {
+            return m_vmProperties.m_trampoline.value_or(last);
+        }
+
+        std::optional<uint32_t> best;
+
+        for (const MemoryLayout &range : memory.m_layout) {
+
+            if (range.size < sizeof(uint32_t)) {
+                continue;
+            }
+
+            // Descend sous les périphériques qui masquent la fin de la plage.
+            uint64_t candidate = (uint64_t{range.start} + range.size - sizeof(uint32_t)) & ~uint64_t{3};
+
+            while (candidate >= range.start && !fitsTrampoline(memory, static_cast<uint32_t>(candidate))) {
+
+                const auto device = std::ranges::find_if(memory.m_devices, [candidate](const MemoryDevice &mapped) {
+                    return candidate + sizeof(uint32_t) > mapped.start &&
+                           candidate < uint64_t{mapped.start} + mapped.size;
+                });
+
+                if (device == memory.m_devices.end() || device->start < sizeof(uint32_t)) {
+                    break;
+                }
+                candidate = (uint64_t{device->start} - sizeof(uint32_t)) & ~uint64_t{3};
+            }
+
+            if (candidate >= range.start && fitsTrampoline(memory, static_cast<uint32_t>(candidate)) &&
+                (!best || candidate > *best)) {
+                best = static_cast<uint32_t>(candidate);
+            }
+        }
+
+        return best.value_or(last);
+    }
+
+    // Adresses des routines de VmProperties::m_hle ; patch y écrit swi Interrupt::Hle et l'ajoute à l'état que
+    // restore() rétablit. Échoue sur une adresse hors de la mémoire, illisible, ou en lecture seule pour le MMU
+    // (MemoryGuarded) : l'hôte y écrit directement, sans passer par les permissions de l'invité.
+    bool hook(const bool patch) {
+
+        m_hleRoutines.clear();
+
+        for (const HleHook &binding : m_vmProperties.m_hle) {
+
+            std::optional<uint32_t> address = binding.m_address;
+
+            for (const char *symbol : Hle::symbols(binding.m_routine)) {
+
+                if (address || !m_program) {
+                    break;
+                }
+                address = m_program->symbol(symbol);
+            }
+
+            if (!address) {
+                continue;
+            }
+
+            if ((*address & 3) != 0 || uint64_t{*address} + sizeof(uint32_t) > m_mem->size() ||
+                !m_mem->readable(*address)) {
+                return false;
+            }
+
+            if constexpr (MemoryHandler::HOST_FAULTS) {
+
+                if (m_mem->readOnlyPage(*address)) {
+                    return false;
+                }
+            }
+
+            if (patch) {
+
+                std::memcpy(m_mem->getAddressZero() + *address, &HLE_INSTRUCTION, sizeof(uint32_t));
+                m_mem->pageImage().keep(m_mem->getAddressZero(), *address, sizeof(uint32_t));
+            }
+
+            m_hleRoutines[*address] = binding.m_routine;
+        }
+
+        return true;
+    }
+
+    // swi Interrupt::Hle, PC sur l'instruction suivante. Sans routine à cette adresse, c'est un swi de l'invité.
+    SwiAction hle() {
+
+        const auto it = m_hleRoutines.find(m_alu->getRegisters()[15] - 4);
+
+        if (it == m_hleRoutines.end()) {
+            return SwiAction::Yield;
+        }
+
+        Hle::run(it->second, *m_alu);
+        return SwiAction::Continue;
+    }
+
+    void attach() {
+
+        m_alu = std::make_unique<PrivateAlu>(m_vmProperties.m_aluProperties);
+        m_vfp = std::make_unique<PrivateVfpv2>(m_vmProperties.m_coproProperties);
+
+        m_alu->attach(m_mem.get());
+        m_alu->attach(m_vfp.get());
+        m_vfp->attach(m_mem.get());
+        m_vfp->attach(m_alu.get());
+
+        for (const auto &[number, handler] : m_vmProperties.m_swiHandlers) {
+            m_alu->setSwiHandler(number, [this, &handler] { return handler(*this); });
+        }
+
+        if (!m_vmProperties.m_hle.empty()) {
+            m_alu->setSwiHandler(static_cast<uint32_t>(Interrupt::Hle), [this] { return hle(); });
+        }
+    }
+
     struct VmProperties m_vmProperties;
     enum Error           m_error;
     std::unique_ptr<MemoryHandler> m_mem;
     std::unique_ptr<PrivateAlu> m_alu;
     std::unique_ptr<PrivateVfpv2> m_vfp;
+    // État des registres que restore() rétablit : celui de l'instantané pour une VM issue de fork().
+    AluState m_origin;
+    // État d'avant le call() en cours, rétabli à son retour.
+    AluState m_caller;
+    // Mot où call() pose swi Interrupt::Return, fixé par reset() et resume().
+    uint32_t m_trampoline = 0;
+
+    // swi Interrupt::Return
+    static constexpr uint32_t RETURN_INSTRUCTION = 0xEF000000 | static_cast<uint32_t>(Interrupt::Return);
+    // swi Interrupt::Hle, et la routine remplacée à chaque adresse où il a été posé.
+    static constexpr uint32_t        HLE_INSTRUCTION = 0xEF000000 | static_cast<uint32_t>(Interrupt::Hle);
+    std::map<uint32_t, HleRoutine> m_hleRoutines;
+    std::shared_ptr<const Program> m_program;
 };
 
 using Vfpv2Unprotected = NullCopro<MemoryRaw>;
@@ -161,6 +483,22 @@ using Vfpv2Protected = NullCopro<MemoryProtected>;
 
 using VmUnprotected = VmImplementation<MemoryRaw, Vfpv2Unprotected>;
 using VmProtected = VmImplementation<MemoryProtected, Vfpv2Protected>;
+using VmUnprotectedThreaded = VmImplementation<MemoryRaw, Vfpv2Unprotected, Dispatch::THREADED>;
+using VmProtectedThreaded   = VmImplementation<MemoryProtected, Vfpv2Protected, Dispatch::THREADED>;
+
+// Tailles instanciées pour MemoryProperties::MASKED : 1 Mio, et 32 Mio pour l'espace de armv4vm.ld.
+using MemoryMasked1M          = MemoryMasked<20>;
+using MemoryMasked32M         = MemoryMasked<25>;
+using VmMasked1M              = VmImplementation<MemoryMasked1M, NullCopro<MemoryMasked1M>>;
+using VmMasked32M             = VmImplementation<MemoryMasked32M, NullCopro<MemoryMasked32M>>;
+using VmMasked1MThreaded      = VmImplementation<MemoryMasked1M, NullCopro<MemoryMasked1M>, Dispatch::THREADED>;
+using VmMasked32MThreaded     = VmImplementation<MemoryMasked32M, NullCopro<MemoryMasked32M>, Dispatch::THREADED>;
+
+#if ARMV4VM_GUARDED
+using Vfpv2Guarded      = NullCopro<MemoryGuarded>;
+using VmGuarded         = VmImplementation<MemoryGuarded, Vfpv2Guarded>;
+using VmGuardedThreaded = VmImplementation<MemoryGuarded, Vfpv2Guarded, Dispatch::THREADED>;
+#endif
 
 #ifdef MY_LIBRARY_STATIC
 // Ne genere pas les constructions suivantes quand ce header est appelé.
@@ -185,18 +523,102 @@ inline std::unique_ptr<Vm> Vm::build(const struct VmProperties &vmProperties) {
         throw VmException(VmError::ConfigurationIncoherence);
     }
 
+    // Les périphériques se greffent sur la table des permissions de MemoryProtected : la mémoire brute n'a pas de
+    // table et la mémoire gardée laisse le MMU trancher.
+    if (!vmProperties.m_memoryProperties.m_devices.empty() &&
+        (vmProperties.m_memoryProperties.m_layout.empty() ||
+         vmProperties.m_memoryProperties.m_type == MemoryProperties::GUARDED)) {
+
+        throw VmException(VmError::ConfigurationIncoherence);
+    }
+
+    // Les gestionnaires de swi sont rangés dans une table indexée par numéro.
+    if (!vmProperties.m_swiHandlers.empty() && vmProperties.m_swiHandlers.rbegin()->first >= 256) {
+
+        throw VmException(VmError::ConfigurationIncoherence);
+    }
+
+    // Le swi des routines HLE est réservé dès qu'une routine est remplacée.
+    if (!vmProperties.m_hle.empty() && vmProperties.m_swiHandlers.contains(static_cast<uint32_t>(Interrupt::Hle))) {
+
+        throw VmException(VmError::ConfigurationIncoherence);
+    }
+
+    // Le trampoline demandé doit pouvoir être écrit puis exécuté. Sans layout, toute la mémoire le peut ; MemoryMasked
+    // ramène de plus toute adresse dans son espace.
+    if (const std::optional<uint32_t> &trampoline = vmProperties.m_trampoline) {
+
+        const MemoryProperties &memory = vmProperties.m_memoryProperties;
+        bool                    fits   = *trampoline % sizeof(uint32_t) == 0;
+
+        if (!memory.m_layout.empty()) {
+            fits = fitsTrampoline(memory, *trampoline);
+        } else if (memory.m_type != MemoryProperties::MASKED) {
+            fits = fits && uint64_t{*trampoline} + sizeof(uint32_t) <= memory.m_memorySizeBytes;
+        }
+
+        if (!fits) {
+            throw VmException(VmError::ConfigurationIncoherence);
+        }
+    }
+
+    // Le mode THREADED a besoin de l'ALU instanciée avec Dispatch::THREADED.
+    const bool threaded = vmProperties.m_aluProperties.m_executionMode == AluProperties::THREADED;
+
+    // Permissions appliquées par le MMU : plages alignées sur les pages, Linux x86-64 uniquement.
+    if (vmProperties.m_memoryProperties.m_type == MemoryProperties::GUARDED) {
+
+#if ARMV4VM_GUARDED
+        if (!MemoryGuarded::isValid(vmProperties.m_memoryProperties)) {
+            throw VmException(VmError::InvalidMemoryLayout);
+        }
+
+        return threaded ? std::unique_ptr<Vm>(new VmGuardedThreaded(vmProperties))
+                        : std::unique_ptr<Vm>(new VmGuarded(vmProperties));
+#else
+        throw VmException(VmError::UnsupportedArchitecture);
+#endif
+    }
+
+    // Adresses masquées : la taille demandée est arrondie à la plus petite taille instanciée qui la contient.
+    if (vmProperties.m_memoryProperties.m_type == MemoryProperties::MASKED) {
+
+        if (!vmProperties.m_memoryProperties.m_layout.empty() ||
+            vmProperties.m_memoryProperties.m_memorySizeBytes > MemoryMasked32M::SIZE) {
+            throw VmException(VmError::InvalidMemoryLayout);
+        }
+
+        if (vmProperties.m_memoryProperties.m_memorySizeBytes <= MemoryMasked1M::SIZE) {
+            return threaded ? std::unique_ptr<Vm>(new VmMasked1MThreaded(vmProperties))
+                            : std::unique_ptr<Vm>(new VmMasked1M(vmProperties));
+        }
+
+        return threaded ? std::unique_ptr<Vm>(new VmMasked32MThreaded(vmProperties))
+                        : std::unique_ptr<Vm>(new VmMasked32M(vmProperties));
+    }
+
     // Quand des permissions sont renseignées,
     // une mémoire de type protegée est créée.
     if(vmProperties.m_memoryProperties.m_layout.empty()) {
 
-        vm = std::unique_ptr<Vm>(new VmUnprotected(vmProperties));
+        vm = threaded ? std::unique_ptr<Vm>(new VmUnprotectedThreaded(vmProperties))
+                      : std::unique_ptr<Vm>(new VmUnprotected(vmProperties));
     }
     else {
-        vm = std::unique_ptr<Vm>(new VmProtected(vmProperties));
+        vm = threaded ? std::unique_ptr<Vm>(new VmProtectedThreaded(vmProperties))
+                      : std::unique_ptr<Vm>(new VmProtected(vmProperties));
     }
 
     return vm;
 }
 
+inline std::unique_ptr<Vm> Vm::fork(const std::shared_ptr<const VmSnapshot> &snapshot) {
+
+    std::unique_ptr<Vm> vm = build(snapshot->m_properties);
+
+    vm->resume(snapshot);
+    return vm;
+}
+
 
 } // namespace armv4vm